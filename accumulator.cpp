@@ -0,0 +1,200 @@
+#include "lib.h"
+#include "accumulator.h"
+#include "kernel.h"
+#include <mutex>
+
+const int SQUARE_INPUTS = 18;    // inputs per square in TranslateBoardtoNN()
+const int PLAYER_INPUT  = 16;    // offset of the player's piece input of a square
+const int OPP_INPUT     = 17;    // offset of the opponent's piece input of a square
+const int ROWS          = 8;     // the row one-hot inputs of a square come first, then the column ones
+const int STATES        = 3;     // states of a square: empty, player, opponent
+const int TABLES_CACHED = 256;   // networks whose tables are kept, see Tables()
+
+
+// What an accumulator derives from a network. It only depends on the weights, so it is
+// built once per NeuralNetwork::Version() and shared by every accumulator using them.
+struct AccumulatorTables
+{
+   int                        width;      // nodes in the first layer after the inputs
+   NeuralNetwork::nodes_type  bias;       // first layer sums of the row/column inputs, same for every board
+   NeuralNetwork::nodes_type  squares;    // first layer contribution of each square, per state
+   FixedHiddenBase*           hidden;     // compiled-in layers after the first, if there are
+   uint64_t                   used;       // tick of the last lookup, to drop the least recently used
+
+   AccumulatorTables( const NeuralNetwork& nn );
+   ~AccumulatorTables() { delete hidden; }
+};
+
+// AccumulatorTables()
+// Folds the first layer weights of 'nn' into the constant row/column bias and the per square
+// table, and builds its compiled-in layers.
+AccumulatorTables::AccumulatorTables( const NeuralNetwork& nn ) : width(nn.GetLayerInfo()[1]), used(0)
+{
+   // the row/column inputs of every square are the same on every board
+   const NeuralNetwork::nodes_type& matrix = nn.GetMatrix();
+   int inputs = nn.InputNodesCount();
+   bias.assign( width, 0.0 );
+   for( int d=0; d<width; ++d )
+      for( int sq=0; sq<64; ++sq )
+      {
+         bias[d] += matrix[d*inputs + sq*SQUARE_INPUTS + sq/8];
+         bias[d] += matrix[d*inputs + sq*SQUARE_INPUTS + ROWS + sq%8];
+      }
+
+   // squares[(square*3 + state)*width + d] = weight from the square's input of 'state' to node d
+   squares.assign( 64*STATES*width, 0.0 );
+   for( int sq=0; sq<64; ++sq )
+      for( int d=0; d<width; ++d )
+      {
+         squares[(sq*STATES+1)*width + d] = matrix[d*inputs + sq*SQUARE_INPUTS + PLAYER_INPUT];
+         squares[(sq*STATES+2)*width + d] = matrix[d*inputs + sq*SQUARE_INPUTS + OPP_INPUT];
+      }
+
+   hidden = CreateFixedHidden( nn );
+}
+
+std::mutex                                                        tables_mutex;
+std::map< uint64_t, std::shared_ptr<AccumulatorTables> >          tables_cache;     // by network version
+uint64_t                                                          tables_tick = 0;
+
+// Tables()
+// Returns the tables of 'nn', building them if its weights have changed since last asked.
+static std::shared_ptr<const AccumulatorTables> Tables( const NeuralNetwork& nn )
+{
+   std::lock_guard<std::mutex> lock( tables_mutex );
+   std::shared_ptr<AccumulatorTables>& t = tables_cache[nn.Version()];
+   if ( !t )
+   {
+      if ( int(tables_cache.size()) > TABLES_CACHED )
+      {
+         std::map< uint64_t, std::shared_ptr<AccumulatorTables> >::iterator oldest = tables_cache.end();
+         for( std::map< uint64_t, std::shared_ptr<AccumulatorTables> >::iterator i=tables_cache.begin(); i!=tables_cache.end(); ++i )
+            if ( i->second && ( oldest == tables_cache.end() || i->second->used < oldest->second->used ) )
+               oldest = i;
+         tables_cache.erase( oldest );
+      }
+      t.reset( new AccumulatorTables( nn ) );
+   }
+   t->used = ++tables_tick;
+   return t;
+}
+
+
+Accumulator::Accumulator() : _nn(0), _player(Reversi::WHITE), _width(0)
+{
+}
+
+// _Ply()
+// Returns the sums at 'ply', growing the stack as needed.
+NeuralNetwork::nodes_type& Accumulator::_Ply( int ply )
+{
+   if ( int(_stack.size()) <= ply )
+      _stack.resize( ply+1, NeuralNetwork::nodes_type(_width) );
+   return _stack[ply];
+}
+
+// _State()
+// Returns the index into the square table of 'piece', seen from the player.
+int Accumulator::_State( Reversi::value_type piece ) const
+{
+   if ( piece == _player ) return 1;
+   if ( piece == Reversi::EMPTY ) return 0;
+   return 2;
+}
+
+// SetNN()
+// Uses network 'nn'. The folded first layer tables and the compiled-in layers after the first
+// are built once per change to its weights, so it must be called again after they change; the
+// sums per ply are kept unless the first layer width differs.
+void Accumulator::SetNN( const NeuralNetwork* nn )
+{
+   _nn = nn;
+   _tables = Tables( *nn );
+   if ( _tables->width != _width )
+   {
+      _width = _tables->width;
+      _stack.clear();
+   }
+}
+
+// SetPlayer()
+// Sees the board from 'player'.
+void Accumulator::SetPlayer( Reversi::value_type player )
+{
+   _player = player;
+}
+
+// Reserve()
+// Makes room for a search 'plies' deep, so that Update() does not allocate.
+void Accumulator::Reserve( int plies )
+{
+   _Ply( plies );
+}
+
+// Refresh()
+// Computes the sums at 'ply' for 'board' from scratch: the bias plus one table row per square.
+void Accumulator::Refresh( int ply, const Reversi::board_type& board )
+{
+   int rows[64];
+   int sq = 0;
+   for( int i=11; i<89; ++i )
+   {
+      if ( i%10 == 0 || i%10 == 9 ) continue;
+      rows[sq] = sq*STATES + _State(board[i]);
+      sq++;
+   }
+   NeuralNetwork::nodes_type& sums = _Ply( ply );
+   sums = _tables->bias;
+   SumRows( &_tables->squares[0], rows, 64, &sums[0], _width );
+}
+
+// Update()
+// Computes the sums at 'ply'+1 for 'child', from the sums of 'parent' at 'ply'.
+void Accumulator::Update( int ply, const Reversi::board_type& parent, const Reversi::board_type& child )
+{
+   _Ply( ply+1 );
+   const NeuralNetwork::nodes_type& src = _stack[ply];
+   NeuralNetwork::nodes_type& dst = _stack[ply+1];
+   dst = src;
+
+   int sq = 0;
+   for( int i=11; i<89; ++i )
+   {
+      if ( i%10 == 0 || i%10 == 9 ) continue;
+      if ( parent[i] != child[i] )
+      {
+         const NeuralNetwork::value_type* from = &_tables->squares[(sq*STATES + _State(parent[i]))*_width];
+         const NeuralNetwork::value_type* to = &_tables->squares[(sq*STATES + _State(child[i]))*_width];
+         for( int d=0; d<_width; ++d ) dst[d] = dst[d] - from[d] + to[d];
+      }
+      sq++;
+   }
+}
+
+// Sums(), Width()
+// Return the first layer sums at 'ply', and how many there are.
+const NeuralNetwork::value_type* Accumulator::Sums( int ply ) const
+{
+   return &_stack[ply][0];
+}
+
+int Accumulator::Width() const
+{
+   return _width;
+}
+
+// Fixed()
+// Returns true if evaluations go through a fixed topology network.
+bool Accumulator::Fixed() const
+{
+   return _tables && _tables->hidden;
+}
+
+// Evaluate()
+// Returns the network output for the position at 'ply'.
+NeuralNetwork::value_type Accumulator::Evaluate( int ply )
+{
+   if ( _tables->hidden ) return _tables->hidden->EvaluateFrom( &_stack[ply][0] );
+   _nn->FeedForwardFrom( _ctx, &_stack[ply][0] );
+   return _nn->GetOutput( _ctx );
+}
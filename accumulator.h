@@ -0,0 +1,43 @@
+#ifndef ALNITE_ACCUMULATOR_H_
+#define ALNITE_ACCUMULATOR_H_
+
+#include "reversi.h"
+#include "nn.h"
+#include "fixednn.h"
+#include <memory>
+
+struct AccumulatorTables;
+
+// Incremental first layer for board inputs (see TranslateBoardtoNN()).
+// Keeps the first layer sums of every position along the search path, one entry per ply.
+// A child's sums are its parent's, corrected only for the squares that changed.
+class Accumulator
+{
+   const NeuralNetwork*                   _nn;
+   NeuralNetwork::Context                 _ctx;
+   std::shared_ptr<const AccumulatorTables> _tables;  // derived from _nn, shared with other accumulators
+   Reversi::value_type                    _player;
+   int                                    _width;     // nodes in the first layer after the inputs
+   std::vector<NeuralNetwork::nodes_type> _stack;     // sums per ply
+
+   NeuralNetwork::nodes_type& _Ply( int ply );
+   int _State( Reversi::value_type piece ) const;
+
+   Accumulator( const Accumulator& );
+   Accumulator& operator=( const Accumulator& );
+
+public:
+   Accumulator();
+
+   void SetNN( const NeuralNetwork* nn );
+   void SetPlayer( Reversi::value_type player );
+   void Reserve( int plies );
+   void Refresh( int ply, const Reversi::board_type& board );
+   void Update( int ply, const Reversi::board_type& parent, const Reversi::board_type& child );
+   NeuralNetwork::value_type Evaluate( int ply );
+   const NeuralNetwork::value_type* Sums( int ply ) const;
+   int Width() const;
+   bool Fixed() const;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "lib.h"
+#include "checkpoint.h"
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+Checkpointer::Checkpointer( const char* filename, const char* prev_filename, const char* progress_filename ) :
+_filename(filename), _prev_filename(prev_filename), _progress_filename(progress_filename),
+_ready(-1), _writing(-1), _quit(false)
+{
+   _buffers[0].has_pop = _buffers[1].has_pop = false;
+   _thread = std::thread( &Checkpointer::_Loop, this );
+}
+
+// ~Checkpointer()
+// Writes the last checkpoint, if any is waiting, then stops the writer.
+Checkpointer::~Checkpointer()
+{
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _quit = true;
+   }
+   _wake.notify_one();
+   _thread.join();
+}
+
+// Save()
+// Checkpoints 'progress' and, unless 0, 'pop'. Returns once they are copied.
+void Checkpointer::Save( const Population* pop, const std::string& progress )
+{
+   // take the buffer that is not being written; no one else touches it while not ready
+   int b;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      b = ( _writing == 0 ) ? 1 : 0;
+      if ( _ready == b ) _ready = -1;
+   }
+   Snapshot& s = _buffers[b];
+   if ( pop )
+   {
+      s.pop = *pop;
+      s.has_pop = true;
+   }
+   s.progress = progress;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _ready = b;
+   }
+   _wake.notify_one();
+}
+
+// Flush()
+// Waits until every checkpoint is written.
+void Checkpointer::Flush()
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   while ( _ready >= 0 || _writing >= 0 ) _idle.wait( lock );
+}
+
+// _Loop()
+// Body of the writer thread.
+void Checkpointer::_Loop()
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   for( ;; )
+   {
+      while ( _ready < 0 && !_quit ) _wake.wait( lock );
+      if ( _ready < 0 ) return;
+      _writing = _ready;
+      _ready = -1;
+      lock.unlock();
+      _Write( _buffers[_writing] );
+      lock.lock();
+      _writing = -1;
+      _idle.notify_all();
+   }
+}
+
+// _Write()
+// Writes snapshot 's': the population first, so that the progress on disk never refers to
+// a population that is not there.
+void Checkpointer::_Write( Checkpointer::Snapshot& s )
+{
+   if ( s.has_pop )
+   {
+      std::string tmp = _filename + ".tmp";
+      if ( s.pop.Save( tmp.c_str() ) )
+         ReplaceFile( tmp.c_str(), _filename.c_str(), _prev_filename.c_str() );
+      else
+         std::cout << "Error in writing checkpoint: " << tmp << std::endl;
+      s.has_pop = false;
+   }
+
+   std::string tmp = _progress_filename + ".tmp";
+   std::ofstream file( tmp.c_str() );
+   file << s.progress;
+   file.close();
+   if ( file ) ReplaceFile( tmp.c_str(), _progress_filename.c_str(), 0 );
+}
+
+
+// ReplaceFile()
+// Renames 'from' to 'to' in one step, so that 'to' is always either the old or the new file.
+// If 'prev' is given, the old 'to' is kept under that name.
+bool ReplaceFile( const char* from, const char* to, const char* prev )
+{
+#ifndef _WIN32
+   if ( prev )
+   {
+      unlink( prev );
+      link( to, prev );
+   }
+#else
+   if ( prev )
+   {
+      remove( prev );
+      rename( to, prev );
+   }
+   else remove( to );
+#endif
+   return rename( from, to ) == 0;
+}
@@ -0,0 +1,53 @@
+#ifndef ALNITE_CHECKPOINT_H_
+#define ALNITE_CHECKPOINT_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "population.h"
+
+// Writes checkpoints of a training run on a thread of its own, so that training does not
+// wait for the disk. A checkpoint is the population, as of the start of a generation, and a
+// progress file with the results so far in that generation (see Population::Progress()).
+// Checkpoints are copied into one of two buffers: the writer works on one while the next is
+// filled, and a newer checkpoint replaces one still waiting. Files are written under a
+// temporary name then renamed over the old one, so a crash leaves the last complete
+// checkpoint; the population it replaces is kept as the previous one.
+class Checkpointer
+{
+   struct Snapshot
+   {
+      Population     pop;
+      bool           has_pop;       // else the population on disk is still current
+      std::string    progress;
+   };
+
+   std::string             _filename;        // population
+   std::string             _prev_filename;   // previous population
+   std::string             _progress_filename;
+   Snapshot                _buffers[2];
+   int                     _ready;           // buffer waiting to be written, -1 if none
+   int                     _writing;         // buffer being written, -1 if none
+   bool                    _quit;
+   std::mutex              _mutex;
+   std::condition_variable _wake;
+   std::condition_variable _idle;
+   std::thread             _thread;
+
+   void _Loop();
+   void _Write( Snapshot& s );
+
+   Checkpointer( const Checkpointer& );
+   Checkpointer& operator=( const Checkpointer& );
+
+public:
+   Checkpointer( const char* filename, const char* prev_filename, const char* progress_filename );
+   ~Checkpointer();
+
+   void Save( const Population* pop, const std::string& progress );
+   void Flush();
+};
+
+bool ReplaceFile( const char* from, const char* to, const char* prev );
+
+#endif
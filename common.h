@@ -7,6 +7,5 @@ double randf(double min, double max);
 double gaussrandf(double mean, double stddev);
 
 extern const double E_NUM;
-extern long randseed;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "lib.h"
+#include "distil.h"
+#include "handler.h"
+#include "common.h"
+
+const int    DISTIL_DEPTH    = 1;
+const int    DISTIL_OPENING  = 6;
+const double DISTIL_EXPLORE  = 0.1;
+const int    HOLDOUT_PERCENT = 10;      // samples kept out of the fit to measure the error
+
+
+// Records every position it is asked to move in, then moves with 'handler', or at random
+// with probability 'explore'.
+class SelfPlayRecorder : public Reversi::PlayerHandler
+{
+   Reversi::PlayerHandler*          _handler;
+   double                           _explore;
+   std::vector<Distiller::Sample>&  _samples;
+
+public:
+   SelfPlayRecorder( Reversi::PlayerHandler* handler, double explore, std::vector<Distiller::Sample>& samples ) :
+   _handler(handler), _explore(explore), _samples(samples)
+   {
+   }
+
+   Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves )
+   {
+      Distiller::Sample s;
+      s.board = board;
+      s.target = 0.0;
+      s.player = Reversi::WHITE; _samples.push_back( s );
+      s.player = Reversi::BLACK; _samples.push_back( s );
+
+      Reversi::index_type move = (*_handler)( board, moves );
+      if ( randf() < _explore )
+      {
+         std::vector<Reversi::index_type> movesv( moves.begin(), moves.end() );
+         move = movesv[int(randf(0.0,double(movesv.size())))];
+      }
+      return move;
+   }
+};
+
+
+Distiller::Distiller( Population::Individual* teacher ) :
+_teacher(teacher), _depth(DISTIL_DEPTH), _opening(DISTIL_OPENING), _explore(DISTIL_EXPLORE)
+{
+}
+
+// SetSelfPlay()
+// Self-play games search 'depth' plies, start with 'opening' random moves and
+// then play a random move with probability 'explore'.
+void Distiller::SetSelfPlay( int depth, int opening, double explore )
+{
+   _depth = depth;
+   _opening = opening;
+   _explore = explore;
+}
+
+// Generate()
+// Plays 'games' games of the teacher against itself and adds their positions, labelled
+// by the teacher, to the samples.
+void Distiller::Generate( int games )
+{
+   NNComputer white( false ), black( false );
+   white.SetNN( _teacher ); white.SetDepth( _depth ); white.SetColor( Reversi::WHITE );
+   black.SetNN( _teacher ); black.SetDepth( _depth ); black.SetColor( Reversi::BLACK );
+   RandomOpening white_open( &white, _opening ), black_open( &black, _opening );
+   SelfPlayRecorder white_rec( &white_open, _explore, _samples ), black_rec( &black_open, _explore, _samples );
+
+   int first = int(_samples.size());
+   Reversi game;
+   for( int g=0; g<games; ++g )
+   {
+      std::cout << "\rSelf-play game " << g+1 << "/" << games; std::cout.flush();
+      game.Start( white_rec, black_rec );
+   }
+   std::cout << "\n";
+
+   NeuralNetwork::Context ctx;
+   NeuralNetwork::nodes_type input;
+   for( unsigned int i=first; i<_samples.size(); ++i )
+   {
+      TranslateBoardtoNN( _samples[i].board, _samples[i].player, input );
+      _teacher->nn.Input( ctx, input );
+      _teacher->nn.FeedForward( ctx );
+      _samples[i].target = _teacher->nn.GetOutput( ctx );
+   }
+}
+
+// Error()
+// Returns the root mean square difference between 'nn' and the teacher over samples
+// 'first' to 'last'-1.
+double Distiller::Error( const NeuralNetwork& nn, int first, int last ) const
+{
+   NeuralNetwork::Context ctx;
+   NeuralNetwork::nodes_type input;
+   double sum = 0.0;
+   for( int i=first; i<last; ++i )
+   {
+      TranslateBoardtoNN( _samples[i].board, _samples[i].player, input );
+      nn.Input( ctx, input );
+      nn.FeedForward( ctx );
+      double err = nn.GetOutput( ctx ) - _samples[i].target;
+      sum += err*err;
+   }
+   return ( last > first ) ? sqrt( sum/(last-first) ) : 0.0;
+}
+
+// Fit()
+// Fits 'student' to the samples by stochastic gradient descent on the squared error,
+// 'epochs' passes with step 'rate'. The last samples are held out of the fit.
+// Returns the root mean square error on them.
+double Distiller::Fit( NeuralNetwork& student, int epochs, double rate )
+{
+   int count = int(_samples.size());
+   int train = count - count*HOLDOUT_PERCENT/100;
+   std::vector<int> order( train );
+   for( int i=0; i<train; ++i ) order[i] = i;
+
+   NeuralNetwork::Context ctx;
+   NeuralNetwork::nodes_type input, grad;
+   for( int e=0; e<epochs; ++e )
+   {
+      // shuffle
+      for( int i=train-1; i>0; --i )
+         std::swap( order[i], order[int(randf(0.0,double(i+1)))] );
+
+      double sum = 0.0;
+      for( int k=0; k<train; ++k )
+      {
+         const Sample& s = _samples[order[k]];
+         TranslateBoardtoNN( s.board, s.player, input );
+         student.Input( ctx, input );
+         student.FeedForward( ctx );
+         double err = student.GetOutput( ctx ) - s.target;
+         sum += err*err;
+         student.Gradient( ctx, grad );
+         student.AdjustMatrix( grad, -rate*err );
+      }
+      std::cout << "Epoch " << e+1 << ": training error " << sqrt( sum/std::max(train,1) ) <<
+         ", held-out error " << Error( student, train, count ) << std::endl;
+   }
+   return Error( student, train, count );
+}
+
+int Distiller::SampleCount() const
+{
+   return int(_samples.size());
+}
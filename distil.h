@@ -0,0 +1,41 @@
+#ifndef ALNITE_DISTIL_H_
+#define ALNITE_DISTIL_H_
+
+#include "reversi.h"
+#include "nn.h"
+#include "population.h"
+
+// Distillation of a network (the teacher) into a smaller and faster one (the student).
+// Positions from self-play games of the teacher are labelled with the teacher's output,
+// from both players' point of view, and the student is fitted to the labels.
+class Distiller
+{
+public:
+   struct Sample
+   {
+      Reversi::board_type        board;
+      Reversi::value_type        player;     // the board is seen from this player
+      NeuralNetwork::value_type  target;     // teacher output
+   };
+
+private:
+   Population::Individual* _teacher;
+   int                     _depth;           // search depth of the self-play games
+   int                     _opening;         // random moves at the start of each game
+   double                  _explore;         // chance of a random move afterwards
+   std::vector<Sample>     _samples;
+
+   Distiller( const Distiller& );
+   Distiller& operator=( const Distiller& );
+
+public:
+   Distiller( Population::Individual* teacher );
+
+   void SetSelfPlay( int depth, int opening, double explore );
+   void Generate( int games );
+   double Fit( NeuralNetwork& student, int epochs, double rate );
+   double Error( const NeuralNetwork& nn, int first, int last ) const;
+   int SampleCount() const;
+};
+
+#endif
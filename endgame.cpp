@@ -0,0 +1,186 @@
+#include "lib.h"
+#include "endgame.h"
+
+const int SOLVER_INFINITY = 100;
+const int SOLVER_ORDER_EMPTIES = 6;    // moves are ordered by the pattern tables above this many empties
+
+
+EndgameAdjudicator::EndgameAdjudicator() :
+_solve_empties(10), _margin_empties(0), _margin(0), _count(0), _patterns(0)
+{
+}
+
+void EndgameAdjudicator::SetSolveEmpties( int e )
+{
+   _solve_empties = e;
+}
+
+void EndgameAdjudicator::SetMargin( int empties, int margin )
+{
+   _margin_empties = empties;
+   _margin = margin;
+}
+
+// SetPatterns()
+// Orders the moves of the solver by 'patterns', best first. 0 goes back to square order.
+// Solutions keep their value, but the piece count of a line may be that of another line
+// of equal value.
+void EndgameAdjudicator::SetPatterns( const PatternTable* patterns )
+{
+   _patterns = patterns;
+}
+
+int EndgameAdjudicator::Count() const
+{
+   return _count;
+}
+
+
+// _Solve()
+// Negamax with alpha-beta on the final disc difference for 'player'.
+// The position to search is _boards[ply]. 'discs' receives the total pieces on the board
+// at the end of the principal line.
+int EndgameAdjudicator::_Solve( int ply, Reversi::value_type player, int empties, int alpha, int beta, bool passed, int& discs )
+{
+   Reversi::value_type opp_pl = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+   Reversi::board_type& board = _boards[ply];
+   Reversi::board_type& bd = _boards[ply+1];
+
+   if ( empties > SOLVER_ORDER_EMPTIES && _patterns )
+   {
+      // the moves, best first for 'player' by the pattern tables
+      Reversi::index_type* moves = &_moves[ply*Reversi::MAX_MOVES];
+      double* scores = &_scores[ply*Reversi::MAX_MOVES];
+      int count = 0;
+      bd = board;
+      for( Reversi::index_type i=11; i<89; ++i )
+      {
+         if ( board[i] != Reversi::EMPTY || i%10 == 0 || i%10 == 9 ) continue;
+         if ( !Reversi::Perform( bd, player, i ) ) continue;
+         double score = _patterns->Evaluate( bd, player );
+         bd = board;
+         int k = count++;
+         for( ; k>0 && scores[k-1] < score; --k )
+         {
+            moves[k] = moves[k-1];
+            scores[k] = scores[k-1];
+         }
+         moves[k] = i;
+         scores[k] = score;
+      }
+
+      int best = -SOLVER_INFINITY, best_discs = 0, d = 0;
+      for( int m=0; m<count; ++m )
+      {
+         Reversi::Perform( bd, player, moves[m] );
+         int res = -_Solve( ply+1, opp_pl, empties-1, -beta, -alpha, false, d );
+         bd = board;
+         if ( res > best )
+         {
+            best = res;
+            best_discs = d;
+            if ( best > alpha ) alpha = best;
+         }
+         if ( alpha >= beta ) break;
+      }
+      if ( count > 0 ) { discs = best_discs; return best; }
+   }
+   else if ( empties > 0 )
+   {
+      int best = -SOLVER_INFINITY, best_discs = 0, d = 0;
+      bool moved = false;
+      bd = board;
+      for( Reversi::index_type i=11; i<89; ++i )
+      {
+         if ( board[i] != Reversi::EMPTY || i%10 == 0 || i%10 == 9 ) continue;
+         if ( !Reversi::Perform( bd, player, i ) ) continue;
+
+         moved = true;
+         int res = -_Solve( ply+1, opp_pl, empties-1, -beta, -alpha, false, d );
+         bd = board;
+         if ( res > best )
+         {
+            best = res;
+            best_discs = d;
+            if ( best > alpha ) alpha = best;
+         }
+         if ( alpha >= beta ) break;
+      }
+
+      if ( moved ) { discs = best_discs; return best; }
+   }
+
+   // no move for this player, the opponent plays again
+   if ( empties > 0 && !passed )
+   {
+      bd = board;
+      return -_Solve( ply+1, opp_pl, empties, -beta, -alpha, true, discs );
+   }
+
+   // game over
+   int p = 0, o = 0;
+   for( Reversi::index_type i=11; i<89; ++i )
+   {
+      if ( board[i] == player ) p++;
+      else if ( board[i] == opp_pl ) o++;
+   }
+   discs = p+o;
+   return p-o;
+}
+
+
+// Solve()
+// Solves 'board' exactly with 'player' to move.
+// Returns the final disc difference for 'player' under perfect play, and the total pieces in 'discs'.
+int EndgameAdjudicator::Solve( const Reversi::board_type& board, Reversi::value_type player, int& discs )
+{
+   int empties = 0;
+   for( Reversi::index_type i=11; i<89; ++i )
+      if ( board[i] == Reversi::EMPTY && i%10 != 0 && i%10 != 9 ) empties++;
+
+   _boards.resize( 2*empties+3, board );
+   _boards[0] = board;
+   if ( _patterns && int(_moves.size()) < (2*empties+3)*Reversi::MAX_MOVES )
+   {
+      _moves.resize( (2*empties+3)*Reversi::MAX_MOVES );
+      _scores.resize( (2*empties+3)*Reversi::MAX_MOVES );
+   }
+   return _Solve( 0, player, empties, -SOLVER_INFINITY, SOLVER_INFINITY, false, discs );
+}
+
+
+// operator()
+// Adjudicates 'board' with 'player' to move.
+// Returns true with the final piece counts in 'w' and 'b' if the game can be decided now.
+bool EndgameAdjudicator::operator()( const Reversi::board_type& board, Reversi::value_type player, int& w, int& b )
+{
+   int empties = 0; w = b = 0;
+   for( Reversi::index_type i=11; i<89; ++i )
+   {
+      if ( i%10 == 0 || i%10 == 9 ) continue;
+      if ( board[i] == Reversi::EMPTY ) empties++;
+      else if ( board[i] == Reversi::WHITE ) w++;
+      else if ( board[i] == Reversi::BLACK ) b++;
+   }
+
+   // disc-margin rule: the leader keeps the current piece counts
+   if ( _margin > 0 && empties <= _margin_empties && std::abs(w-b) >= _margin )
+   {
+      _count++;
+      return true;
+   }
+
+   // exact solve
+   if ( empties <= _solve_empties )
+   {
+      int discs = 0;
+      int diff = Solve( board, player, discs );
+      if ( player == Reversi::BLACK ) diff = -diff;   // diff is now white minus black
+      w = (discs+diff)/2;
+      b = (discs-diff)/2;
+      _count++;
+      return true;
+   }
+
+   return false;
+}
@@ -0,0 +1,38 @@
+#ifndef ALNITE_ENDGAME_H_
+#define ALNITE_ENDGAME_H_
+
+#include "reversi.h"
+#include "patterns.h"
+
+// Endgame adjudication.
+// Stops a game early once the result is known: either the position is solved exactly
+// (few enough empty squares), or one side leads by a decisive margin late in the game.
+// With pattern tables set, the solver tries the moves they score best first, so that it cuts
+// sooner in deeper solves.
+class EndgameAdjudicator : public Reversi::Adjudicator
+{
+   int      _solve_empties;      // solve exactly when this many empties or fewer are left
+   int      _margin_empties;     // disc-margin rule applies when this many empties or fewer are left
+   int      _margin;             // disc-margin needed to adjudicate a win, 0 to disable
+   int      _count;              // number of games adjudicated so far
+   const PatternTable* _patterns;   // orders the solver's moves, if set
+
+   std::vector<Reversi::board_type> _boards;    // one scratch board per ply of the solver
+   std::vector<Reversi::index_type> _moves;     // Reversi::MAX_MOVES ordered moves per ply of the solver
+   std::vector<double>              _scores;    // of _moves
+
+   int _Solve( int ply, Reversi::value_type player, int empties, int alpha, int beta, bool passed, int& discs );
+
+public:
+   EndgameAdjudicator();
+
+   void SetSolveEmpties( int e );
+   void SetMargin( int empties, int margin );
+   void SetPatterns( const PatternTable* patterns );
+   int Count() const;
+
+   int Solve( const Reversi::board_type& board, Reversi::value_type player, int& discs );
+   bool operator()( const Reversi::board_type& board, Reversi::value_type player, int& w, int& b );
+};
+
+#endif
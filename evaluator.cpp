@@ -0,0 +1,39 @@
+#include "lib.h"
+#include "evaluator.h"
+#include "handler.h"
+
+// Square weights of HeuristicEvaluator, by board index.
+const int HEURISTIC_WEIGHTS[100] =
+{
+   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+   0,  100,  -20,   10,    5,    5,   10,  -20,  100,    0,
+   0,  -20,  -50,   -2,   -2,   -2,   -2,  -50,  -20,    0,
+   0,   10,   -2,   -1,   -1,   -1,   -1,   -2,   10,    0,
+   0,    5,   -2,   -1,   -1,   -1,   -1,   -2,    5,    0,
+   0,    5,   -2,   -1,   -1,   -1,   -1,   -2,    5,    0,
+   0,   10,   -2,   -1,   -1,   -1,   -1,   -2,   10,    0,
+   0,  -20,  -50,   -2,   -2,   -2,   -2,  -50,  -20,    0,
+   0,  100,  -20,   10,    5,    5,   10,  -20,  100,    0,
+   0,    0,    0,    0,    0,    0,    0,    0,    0,    0
+};
+
+// QuantizedEvaluator::Evaluate()
+// The quantised network has no incremental first layer, so every leaf is translated in full.
+NeuralNetwork::value_type QuantizedEvaluator::Evaluate( int, const Reversi::board_type& board )
+{
+   TranslateBoardtoNN( board, _player, *_input );
+   return _qnn->Evaluate( *_ctx, *_input );
+}
+
+// HeuristicEvaluator::Evaluate()
+// Sums the weights of the player's squares, less those of the opponent's.
+NeuralNetwork::value_type HeuristicEvaluator::Evaluate( int, const Reversi::board_type& board )
+{
+   int sum = 0;
+   for( int i=11; i<89; ++i )
+   {
+      if ( board[i] == _player ) sum += HEURISTIC_WEIGHTS[i];
+      else if ( board[i] != Reversi::EMPTY ) sum -= HEURISTIC_WEIGHTS[i];
+   }
+   return NeuralNetwork::value_type( sum );
+}
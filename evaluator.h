@@ -0,0 +1,84 @@
+#ifndef ALNITE_EVALUATOR_H_
+#define ALNITE_EVALUATOR_H_
+
+#include "reversi.h"
+#include "nn.h"
+#include "qnn.h"
+#include "accumulator.h"
+#include "patterns.h"
+
+// Leaf evaluators of the search. NNComputer's search is a template compiled once for each
+// of them, so calls at the leaves are direct and can be inlined. An evaluator provides:
+//
+//   void Refresh( int ply, const Reversi::board_type& board )
+//       'board' is the position at 'ply', seen from scratch
+//   void Update( int ply, const Reversi::board_type& parent, const Reversi::board_type& child )
+//       'child' at 'ply'+1 follows 'parent' at 'ply'
+//   NeuralNetwork::value_type Evaluate( int ply, const Reversi::board_type& board )
+//       value of 'board' at 'ply' for the searching player, higher is better
+//
+// Evaluators are cheap handles to state kept by NNComputer and are made once per search.
+
+
+// Full network, through the incremental first layer of an Accumulator.
+class NetworkEvaluator
+{
+   Accumulator* _acc;
+
+public:
+   NetworkEvaluator( Accumulator* acc ) : _acc(acc) {}
+
+   void Refresh( int ply, const Reversi::board_type& board ) { _acc->Refresh( ply, board ); }
+   void Update( int ply, const Reversi::board_type& parent, const Reversi::board_type& child ) { _acc->Update( ply, parent, child ); }
+   NeuralNetwork::value_type Evaluate( int ply, const Reversi::board_type& ) { return _acc->Evaluate( ply ); }
+};
+
+
+// Quantised network, on the full input of each leaf.
+class QuantizedEvaluator
+{
+   const QuantizedNetwork*    _qnn;
+   QuantizedNetwork::Context* _ctx;
+   NeuralNetwork::nodes_type* _input;
+   Reversi::value_type        _player;
+
+public:
+   QuantizedEvaluator( const QuantizedNetwork* qnn, QuantizedNetwork::Context* ctx, NeuralNetwork::nodes_type* input, Reversi::value_type player ) :
+   _qnn(qnn), _ctx(ctx), _input(input), _player(player) {}
+
+   void Refresh( int, const Reversi::board_type& ) {}
+   void Update( int, const Reversi::board_type&, const Reversi::board_type& ) {}
+   NeuralNetwork::value_type Evaluate( int ply, const Reversi::board_type& board );
+};
+
+
+// Pattern tables.
+class PatternEvaluator
+{
+   const PatternTable*  _patterns;
+   Reversi::value_type  _player;
+
+public:
+   PatternEvaluator( const PatternTable* patterns, Reversi::value_type player ) : _patterns(patterns), _player(player) {}
+
+   void Refresh( int, const Reversi::board_type& ) {}
+   void Update( int, const Reversi::board_type&, const Reversi::board_type& ) {}
+   NeuralNetwork::value_type Evaluate( int, const Reversi::board_type& board ) { return _patterns->Evaluate( board, _player ); }
+};
+
+
+// Fixed weights of the squares, corners high and the squares next to them low, as a
+// hand-made opponent that needs no training.
+class HeuristicEvaluator
+{
+   Reversi::value_type  _player;
+
+public:
+   HeuristicEvaluator( Reversi::value_type player ) : _player(player) {}
+
+   void Refresh( int, const Reversi::board_type& ) {}
+   void Update( int, const Reversi::board_type&, const Reversi::board_type& ) {}
+   NeuralNetwork::value_type Evaluate( int ply, const Reversi::board_type& board );
+};
+
+#endif
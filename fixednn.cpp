@@ -0,0 +1,50 @@
+#include "lib.h"
+#include "fixednn.h"
+
+// Topologies compiled in. Add a line here for a new nn.conf layer setup.
+template< int I, int H1, int H2, int O >
+static FixedNetworkBase* TryFixed( const NeuralNetwork& nn )
+{
+   if ( !FixedNetwork<I,H1,H2,O>::Matches( nn ) ) return 0;
+   FixedNetwork<I,H1,H2,O>* f = new FixedNetwork<I,H1,H2,O>;
+   f->Load( nn );
+   return f;
+}
+
+template< int I, int H1, int H2, int O >
+static FixedHiddenBase* TryHidden( const NeuralNetwork& nn )
+{
+   if ( !FixedNetwork<I,H1,H2,O>::Matches( nn ) ) return 0;
+   FixedHiddenLayers<H1,H2,O>* f = new FixedHiddenLayers<H1,H2,O>;
+   f->Load( &nn.GetMatrix()[I*H1], nn.GetActivation() );
+   return f;
+}
+
+
+// CreateFixedNetwork()
+// Returns a new fixed network with the weights of 'nn', or 0 if its topology is not compiled in.
+// The caller owns the result.
+FixedNetworkBase* CreateFixedNetwork( const NeuralNetwork& nn )
+{
+   FixedNetworkBase* f = 0;
+   if ( (f = TryFixed<1152, 40, 10, 1>( nn )) ) return f;
+   if ( (f = TryFixed<1152, 32, 16, 1>( nn )) ) return f;
+   if ( (f = TryFixed<1152, 64, 32, 1>( nn )) ) return f;
+   if ( (f = TryFixed<1152, 80, 20, 1>( nn )) ) return f;
+   if ( (f = TryFixed<1152, 100, 40, 1>( nn )) ) return f;
+   return 0;
+}
+
+// CreateFixedHidden()
+// Same as CreateFixedNetwork() for the layers after the first, whose sums are given to
+// EvaluateFrom(). The first layer weights are not copied.
+FixedHiddenBase* CreateFixedHidden( const NeuralNetwork& nn )
+{
+   FixedHiddenBase* f = 0;
+   if ( (f = TryHidden<1152, 40, 10, 1>( nn )) ) return f;
+   if ( (f = TryHidden<1152, 32, 16, 1>( nn )) ) return f;
+   if ( (f = TryHidden<1152, 64, 32, 1>( nn )) ) return f;
+   if ( (f = TryHidden<1152, 80, 20, 1>( nn )) ) return f;
+   if ( (f = TryHidden<1152, 100, 40, 1>( nn )) ) return f;
+   return 0;
+}
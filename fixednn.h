@@ -0,0 +1,173 @@
+#ifndef ALNITE_FIXEDNN_H_
+#define ALNITE_FIXEDNN_H_
+
+#include "nn.h"
+#include "kernel.h"
+
+// Networks with a topology fixed at compile time.
+// Layer sizes are constants, so loops are unrolled and vectorised by the compiler, and
+// activations live on the stack. CreateFixedNetwork() returns one for the topologies
+// instantiated in fixednn.cpp, otherwise NeuralNetwork is used as it is. CreateFixedHidden()
+// returns the layers after the first only, for callers that sum the first layer themselves.
+class FixedHiddenBase
+{
+public:
+   virtual ~FixedHiddenBase() {}
+
+   // same as NeuralNetwork::FeedForwardFrom() followed by GetOutput()
+   virtual NeuralNetwork::value_type EvaluateFrom( const NeuralNetwork::value_type* sums ) const = 0;
+};
+
+class FixedNetworkBase : public FixedHiddenBase
+{
+public:
+   // same as NeuralNetwork::Input() and FeedForward() followed by GetOutput()
+   virtual NeuralNetwork::value_type Evaluate( const NeuralNetwork::nodes_type& input ) const = 0;
+};
+
+
+// The loops below are compiled once per instruction set, picked when the program loads.
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define FIXED_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define FIXED_CLONES
+#endif
+
+// Four doubles, loaded and stored without alignment requirements.
+typedef NeuralNetwork::value_type fixed_vec __attribute__((vector_size(32), aligned(8)));
+const int FIXED_LANES = 4;
+const int FIXED_REGISTERS = 8;
+
+// FixedLayer()
+// out = in * w. Up to FIXED_REGISTERS vectors of outputs are summed at a time, so that the
+// sums stay in registers; outputs left over are summed as dot products.
+template< int S, int D >
+inline void FixedLayer( const NeuralNetwork::value_type (*w)[D], const NeuralNetwork::value_type* in, NeuralNetwork::value_type* out )
+{
+   const int vecs = D/FIXED_LANES < FIXED_REGISTERS ? D/FIXED_LANES : FIXED_REGISTERS;
+   int d0 = 0;
+   for( ; vecs > 0 && d0+vecs*FIXED_LANES<=D; d0+=vecs*FIXED_LANES )
+   {
+      fixed_vec acc[vecs > 0 ? vecs : 1];
+      for( int j=0; j<vecs; ++j ) acc[j] = (fixed_vec){ 0.0, 0.0, 0.0, 0.0 };
+      for( int s=0; s<S; ++s )
+      {
+         const fixed_vec x = { in[s], in[s], in[s], in[s] };
+#pragma GCC unroll 8
+         for( int j=0; j<vecs; ++j )
+            acc[j] += x * *(const fixed_vec*)&w[s][d0+j*FIXED_LANES];
+      }
+      for( int j=0; j<vecs; ++j ) *(fixed_vec*)&out[d0+j*FIXED_LANES] = acc[j];
+   }
+   for( ; d0<D; ++d0 )
+   {
+      fixed_vec acc = { 0.0, 0.0, 0.0, 0.0 };
+      int s = 0;
+      for( ; s+FIXED_LANES<=S; s+=FIXED_LANES )
+      {
+         const fixed_vec x = { w[s][d0], w[s+1][d0], w[s+2][d0], w[s+3][d0] };
+         acc += x * *(const fixed_vec*)&in[s];
+      }
+      NeuralNetwork::value_type sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+      for( ; s<S; ++s ) sum += in[s] * w[s][d0];
+      out[d0] = sum;
+   }
+}
+
+// FixedHidden()
+// Layers after the first, from the first layer sums 'sums'.
+template< int H1, int H2, int O >
+FIXED_CLONES NeuralNetwork::value_type FixedHidden( const NeuralNetwork::value_type (*w2)[H2], const NeuralNetwork::value_type (*w3)[O],
+   int activation, const NeuralNetwork::value_type* sums )
+{
+   NeuralNetwork::value_type h1[H1], h2[H2], out[O];
+   for( int d=0; d<H1; ++d ) h1[d] = sums[d];
+   ActivationVector( activation, h1, H1 );
+
+   FixedLayer<H1,H2>( w2, h1, h2 );
+   ActivationVector( activation, h2, H2 );
+
+   FixedLayer<H2,O>( w3, h2, out );
+
+   return 1.0/(1.0+exp(-out[O-1]/8.0));
+}
+
+// FixedFirst()
+// First layer sums of 'input'.
+template< int I, int H1 >
+FIXED_CLONES void FixedFirst( const NeuralNetwork::value_type (*w1)[H1], const NeuralNetwork::nodes_type& input, NeuralNetwork::value_type* sums )
+{
+   FixedLayer<I,H1>( w1, &input[0], sums );
+}
+
+
+// weights are stored source-major, so that each source adds to a whole layer
+template< int H1, int H2, int O >
+class FixedHiddenLayers : public FixedHiddenBase
+{
+   typedef NeuralNetwork::value_type value_type;
+
+   value_type  _w2[H1][H2];
+   value_type  _w3[H2][O];
+   int         _activation;
+
+public:
+   // Load()
+   // Copies the weights 'w' of the layers after the first, in NeuralNetwork::GetMatrix() order.
+   void Load( const value_type* w, int activation )
+   {
+      for( int d=0; d<H2; ++d ) for( int s=0; s<H1; ++s ) _w2[s][d] = *w++;
+      for( int d=0; d<O; ++d ) for( int s=0; s<H2; ++s ) _w3[s][d] = *w++;
+      _activation = activation;
+   }
+
+   value_type EvaluateFrom( const value_type* sums ) const
+   {
+      return FixedHidden<H1,H2,O>( _w2, _w3, _activation, sums );
+   }
+};
+
+
+template< int I, int H1, int H2, int O >
+class FixedNetwork : public FixedNetworkBase
+{
+   typedef NeuralNetwork::value_type value_type;
+
+   value_type                 _w1[I][H1];
+   FixedHiddenLayers<H1,H2,O> _hidden;
+
+public:
+   static bool Matches( const NeuralNetwork& nn )
+   {
+      const NeuralNetwork::layer_info_type& li = nn.GetLayerInfo();
+      return li.size() == 4 && li[0] == I && li[1] == H1 && li[2] == H2 && li[3] == O;
+   }
+
+   // Load()
+   // Copies the weights and activation of 'nn', which must match this topology.
+   void Load( const NeuralNetwork& nn )
+   {
+      const NeuralNetwork::nodes_type& m = nn.GetMatrix();
+      const value_type* w = &m[0];
+      for( int d=0; d<H1; ++d ) for( int s=0; s<I; ++s ) _w1[s][d] = *w++;
+      _hidden.Load( w, nn.GetActivation() );
+   }
+
+   value_type EvaluateFrom( const value_type* sums ) const
+   {
+      return _hidden.EvaluateFrom( sums );
+   }
+
+   value_type Evaluate( const NeuralNetwork::nodes_type& input ) const
+   {
+      value_type sums[H1];
+      FixedFirst<I,H1>( _w1, input, sums );
+      return EvaluateFrom( sums );
+   }
+};
+
+
+FixedNetworkBase* CreateFixedNetwork( const NeuralNetwork& nn );
+FixedHiddenBase* CreateFixedHidden( const NeuralNetwork& nn );
+
+#endif
@@ -1,6 +1,7 @@
 #include "lib.h"
 #include "handler.h"
 #include "common.h"
+#include "accumulator.h"
 
 
 const double POS_INFINITY = 10000000.0;
@@ -121,7 +122,7 @@ Reversi::index_type HumanHandler::operator() (const Reversi::board_type& board,
 
 
 // ----------------- NEURAL NETWORK COMPUTER -----------------
-NNComputer::NNComputer( bool v ) : _verbose(v), _depth(1)
+NNComputer::NNComputer( bool v ) : _ind(0), _verbose(v), _depth(1), _leaves(&_acc), _qnn(0), _patterns(0), _heuristic(false)
 {
 }
 
@@ -133,6 +134,48 @@ void NNComputer::SetDepth( int d )
 void NNComputer::SetNN( Population::Individual* nind )
 {
 	_ind = nind;
+   if ( _ind ) _acc.SetNN( &_ind->nn );
+}
+
+// SetLeafNN()
+// Cascades the evaluation: 'nn', typically a small network distilled from this one, scores
+// the leaves of the search, and this player's own network orders the root moves and still
+// scores them alone at depth 1. 0 goes back to a single network.
+void NNComputer::SetLeafNN( const NeuralNetwork* nn )
+{
+   if ( nn )
+   {
+      _leaf_acc.SetNN( nn );
+      _leaves = &_leaf_acc;
+   }
+   else
+      _leaves = &_acc;
+}
+
+// SetQuantized()
+// Scores the leaves with the quantised network 'qnn', cascaded under this player's own
+// network as with SetLeafNN() if it has one. 0 goes back to the networks.
+void NNComputer::SetQuantized( const QuantizedNetwork* qnn )
+{
+   _qnn = qnn;
+}
+
+// SetPatterns()
+// Scores the leaves with the pattern table 'patterns', cascaded under this player's own
+// network as with SetLeafNN() if it has one; no network is needed otherwise. 0 goes back
+// to the networks. Takes precedence over SetQuantized().
+void NNComputer::SetPatterns( const PatternTable* patterns )
+{
+   _patterns = patterns;
+}
+
+// SetHeuristic()
+// Scores the leaves with the fixed square weights of HeuristicEvaluator if 'heuristic',
+// cascaded under this player's own network as with SetLeafNN() if it has one; no network
+// is needed otherwise. Takes precedence over SetPatterns() and SetQuantized().
+void NNComputer::SetHeuristic( bool heuristic )
+{
+   _heuristic = heuristic;
 }
 
 void NNComputer::SetColor( Reversi::value_type col )
@@ -141,34 +184,91 @@ void NNComputer::SetColor( Reversi::value_type col )
    if ( _color == Reversi::WHITE ) _colorstr = "WHITE";
    else _colorstr = "BLACK";
    _opp_color = ( _color == Reversi::WHITE ) ? Reversi::BLACK : Reversi::WHITE;
+   _acc.SetPlayer( _color );
+   _leaf_acc.SetPlayer( _color );
+}
+
+
+// Reserve()
+// Sizes all search buffers for the current depth and network, so that searching does not allocate.
+void NNComputer::Reserve()
+{
+   _ws.Reserve( _depth );
+   if ( int(_root_out.size()) < Reversi::MAX_MOVES ) _root_out.resize( Reversi::MAX_MOVES );
+   if ( _leaves != &_acc ) _leaves->Reserve( _depth );
+   if ( !_ind ) return;
+
+   _acc.Reserve( _depth );
+   int width = _acc.Width();
+   int scratch = _ind->nn.BatchScratchSize( Reversi::MAX_MOVES );
+   if ( int(_root_sums.size()) < Reversi::MAX_MOVES*width ) _root_sums.resize( Reversi::MAX_MOVES*width );
+   if ( int(_root_scratch.size()) < scratch ) _root_scratch.resize( scratch );
 }
 
 
+// OrderRootMoves()
+// Lists 'moves' in the root frame. When cascaded, they are sorted by this player's own network,
+// best first, so that the search cuts more and keeps the first of equally scored moves.
+void NNComputer::OrderRootMoves( const Reversi::board_type& board, Reversi::move_list& moves )
+{
+   SearchWorkspace::Frame& frame = _ws[0];
+   frame.move_count = 0;
+   for( Reversi::move_list::iterator it = moves.begin(); it != moves.end(); ++it )
+      frame.moves[frame.move_count++] = *it;
+   bool cascaded = _heuristic || _patterns || _qnn || _leaves != &_acc;
+   if ( !_ind || !cascaded ) return;
+
+   Reversi::board_type& bd = _ws[1].board;
+   _acc.Refresh( 0, board );
+   for( int m=0; m<frame.move_count; ++m )
+   {
+      bd = board;
+      Reversi::Perform( bd, _color, frame.moves[m] );
+      _acc.Update( 0, board, bd );
+      _root_out[m] = _acc.Evaluate( 1 );
+   }
+   for( int m=1; m<frame.move_count; ++m )
+   {
+      Reversi::index_type move = frame.moves[m];
+      NeuralNetwork::value_type score = _root_out[m];
+      int k = m;
+      for( ; k>0 && _root_out[k-1] < score; --k )
+      {
+         frame.moves[k] = frame.moves[k-1];
+         _root_out[k] = _root_out[k-1];
+      }
+      frame.moves[k] = move;
+      _root_out[k] = score;
+   }
+}
+
 // BestMove()
 // Top level MAX, slightly different than the other MAXs because it returns the best move
 // Returns the best move
-Reversi::index_type NNComputer::BestMove( const Reversi::board_type& board, Reversi::move_list& moves, int depth )
+template< class E >
+Reversi::index_type NNComputer::BestMove( E& eval, const Reversi::board_type& board, Reversi::move_list& moves, int depth )
 {
    // find the best move
    NeuralNetwork::value_type alpha = NEG_INFINITY;
    NeuralNetwork::value_type beta = POS_INFINITY;
-   Reversi::board_type bd;
+   Reversi::board_type& bd = _ws[1].board;
    Reversi::index_type best_move = 0, move = 0;
    NeuralNetwork::value_type res;
-   Reversi::move_list::iterator it = moves.begin();
-   while( it != moves.end() )
+   OrderRootMoves( board, moves );
+   const SearchWorkspace::Frame& frame = _ws[0];
+   eval.Refresh( 0, board );
+   for( int m=0; m<frame.move_count; ++m )
    {
-      move = *it;
+      move = frame.moves[m];
       bd = board;
       Reversi::Perform( bd, _color, move );
-      res = MinMove( bd, alpha, beta, depth-1 );
+      eval.Update( _depth-depth, board, bd );
+      res = MinMove( eval, bd, alpha, beta, depth-1 );
       if ( res > alpha )
       {
          best_move = move;
          alpha = res;
       }
-
-      ++it;
    }
    return best_move;
 }
@@ -177,46 +277,39 @@ Reversi::index_type NNComputer::BestMove( const Reversi::board_type& board, Reve
 // MinMove()
 // Min Tree.
 // Returns the value of the worst move made by the opponent
-NeuralNetwork::value_type NNComputer::MinMove( const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth )
+template< class E >
+NeuralNetwork::value_type NNComputer::MinMove( E& eval, const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth )
 {
    // end of search tree
    if ( depth == 0 )
-   {
-      NeuralNetwork::nodes_type input;
-      TranslateBoardtoNN( board, _color, input );
-      _ind->nn.Input( input );
-      _ind->nn.FeedForward();
-      return _ind->nn.GetOutput();
-   }
+      return eval.Evaluate( _depth, board );
 
    // or no more move available for the opponent, this becomes a MAX
-   Reversi::move_list moves;
-   if ( !Reversi::MoveAvailable(board, _opp_color, moves) )
+   int ply = _depth-depth;
+   SearchWorkspace::Frame& frame = _ws[ply];
+   frame.move_count = Reversi::GenerateMoves( board, _opp_color, frame.moves );
+   if ( frame.move_count == 0 )
    {
-      return MaxMove( board, alpha, beta, depth-1);
+      eval.Update( ply, board, board );
+      return MaxMove( eval, board, alpha, beta, depth-1);
    }
 
    // for each move available..
-   Reversi::board_type bd;
-   Reversi::index_type best_move = 0, move = 0;
+   Reversi::board_type& bd = _ws[ply+1].board;
    NeuralNetwork::value_type res, best_res = POS_INFINITY;
-   Reversi::move_list::iterator it = moves.begin();
-   while( it != moves.end() )
+   for( int m=0; m<frame.move_count; ++m )
    {
-      move = *it;
       bd = board;
-      Reversi::Perform( bd, _opp_color, move );
-      res = MaxMove( bd, alpha, beta, depth-1 );
+      Reversi::Perform( bd, _opp_color, frame.moves[m] );
+      eval.Update( ply, board, bd );
+      res = MaxMove( eval, bd, alpha, beta, depth-1 );
       if ( res < best_res )
       {
          best_res = res;
-         best_move = move;
          if ( best_res < beta ) beta = best_res;
       }
 
       if ( beta < alpha ) return beta;
-
-      ++it;
    }
    return best_res;
 }
@@ -224,46 +317,39 @@ NeuralNetwork::value_type NNComputer::MinMove( const Reversi::board_type& board,
 // MaxMove()
 // Max Tree.
 // Returns the value of the best move made by this player
-NeuralNetwork::value_type NNComputer::MaxMove( const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth )
+template< class E >
+NeuralNetwork::value_type NNComputer::MaxMove( E& eval, const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth )
 {
    // end of search tree
    if ( depth == 0 )
-   {
-      NeuralNetwork::nodes_type input;
-      TranslateBoardtoNN( board, _color, input );
-      _ind->nn.Input( input );
-      _ind->nn.FeedForward();
-      return _ind->nn.GetOutput();
-   }
+      return eval.Evaluate( _depth, board );
 
    // or no more move available for this player, this becomes a MIN
-   Reversi::move_list moves;
-   if ( !Reversi::MoveAvailable(board, _color, moves) )
+   int ply = _depth-depth;
+   SearchWorkspace::Frame& frame = _ws[ply];
+   frame.move_count = Reversi::GenerateMoves( board, _color, frame.moves );
+   if ( frame.move_count == 0 )
    {
-      return MinMove( board, alpha, beta, depth-1);
+      eval.Update( ply, board, board );
+      return MinMove( eval, board, alpha, beta, depth-1);
    }
 
    // for each move available..
-   Reversi::board_type bd;
-   Reversi::index_type best_move = 0, move = 0;
+   Reversi::board_type& bd = _ws[ply+1].board;
    NeuralNetwork::value_type res, best_res = NEG_INFINITY;
-   Reversi::move_list::iterator it = moves.begin();
-   while( it != moves.end() )
+   for( int m=0; m<frame.move_count; ++m )
    {
-      move = *it;
       bd = board;
-      Reversi::Perform( bd, _color, move );
-      res = MinMove( bd, alpha, beta, depth-1 );
+      Reversi::Perform( bd, _color, frame.moves[m] );
+      eval.Update( ply, board, bd );
+      res = MinMove( eval, bd, alpha, beta, depth-1 );
       if ( res > best_res )
       {
          best_res = res;
-         best_move = move;
          if ( best_res > alpha ) alpha = best_res;
       }
 
       if ( beta < alpha ) return alpha;
-
-      ++it;
    }
    return best_res;
 }
@@ -286,35 +372,56 @@ Reversi::index_type NNComputer::operator() (const Reversi::board_type& board, Re
    }
 
    Reversi::index_type best_move = 0;
-   if ( _depth == 1 )
+   Reserve();
+   if ( _depth == 1 && _ind )
    {
-      // find the best move
-      NeuralNetwork::nodes_type input;
-      Reversi::board_type bd;
-      Reversi::index_type move = 0;
-      NeuralNetwork::value_type best_res = NEG_INFINITY, res = NEG_INFINITY;
+      // score all moves, in one batch unless the network has a fixed topology
+      int count = int(moves.size()), width = _acc.Width();
+      Reversi::board_type& bd = _ws[1].board;
       Reversi::move_list::iterator it = moves.begin();
-      while( it != moves.end() )
+      _acc.Refresh( 0, board );
+      for( int m=0; m<count; ++m, ++it )
       {
-         move = *it;
          bd = board;
-         Reversi::Perform( bd, _color, move );
-         TranslateBoardtoNN( bd, _color, input );
-         _ind->nn.Input( input );
-         _ind->nn.FeedForward();
-         res = _ind->nn.GetOutput();
-         if ( res > best_res )
+         Reversi::Perform( bd, _color, *it );
+         _acc.Update( 0, board, bd );
+         if ( _acc.Fixed() ) _root_out[m] = _acc.Evaluate( 1 );
+         else std::copy( _acc.Sums(1), _acc.Sums(1)+width, &_root_sums[m*width] );
+      }
+      if ( !_acc.Fixed() )
+         _ind->nn.EvaluateBatchFrom( &_root_sums[0], count, &_root_out[0], &_root_scratch[0] );
+
+      // find the best move
+      NeuralNetwork::value_type best_res = NEG_INFINITY;
+      it = moves.begin();
+      for( int m=0; m<count; ++m, ++it )
+      {
+         if ( _root_out[m] > best_res )
          {
-            best_move = move;
-            best_res = res;
+            best_move = *it;
+            best_res = _root_out[m];
          }
-
-         ++it;
       }
    }
+   else if ( _heuristic )
+   {
+      HeuristicEvaluator eval( _color );
+      best_move = BestMove( eval, board, moves, _depth );
+   }
+   else if ( _patterns )
+   {
+      PatternEvaluator eval( _patterns, _color );
+      best_move = BestMove( eval, board, moves, _depth );
+   }
+   else if ( _qnn )
+   {
+      QuantizedEvaluator eval( _qnn, &_qctx, &_qinput, _color );
+      best_move = BestMove( eval, board, moves, _depth );
+   }
    else
    {
-      best_move = BestMove( board, moves, _depth );
+      NetworkEvaluator eval( _leaves );
+      best_move = BestMove( eval, board, moves, _depth );
    }
 
    if ( _verbose )
@@ -324,9 +431,34 @@ Reversi::index_type NNComputer::operator() (const Reversi::board_type& board, Re
 }
 
 
+// ----------------- RANDOM OPENING -----------------
+RandomOpening::RandomOpening( Reversi::PlayerHandler* handler, int plies ) : _handler(handler), _plies(plies)
+{
+}
+
+Reversi::index_type RandomOpening::operator()( const Reversi::board_type& board, Reversi::move_list& moves )
+{
+   // moves made so far, passes aside
+   int played = -4;
+   for( int i=11; i<89; ++i )
+      if ( board[i] != Reversi::EMPTY ) played++;
+   if ( played >= _plies ) return (*_handler)( board, moves );
+
+   std::vector<Reversi::index_type> movesv( moves.begin(), moves.end() );
+   return movesv[int(randf(0.0,double(movesv.size())))];
+}
+
+
 // ----------------- RANDOM COMPUTER -----------------
-RandomComputer::RandomComputer( bool v ) : _verbose(v)
+RandomComputer::RandomComputer( bool v ) : _verbose(v), _random(0)
+{
+}
+
+// SetStream()
+// Draws the moves from 'random' rather than from the thread's stream. 0 goes back to it.
+void RandomComputer::SetStream( RandomStream* random )
 {
+   _random = random;
 }
 
 void RandomComputer::SetColor( Reversi::value_type col )
@@ -355,7 +487,8 @@ Reversi::index_type RandomComputer::operator()( const Reversi::board_type& board
 
    // pick a random move
    std::vector<Reversi::index_type> movesv(moves.begin(), moves.end());
-   int m = (int) randf(0.0,double(movesv.size()));
+   RandomStream& random = _random ? *_random : ThreadRandom();
+   int m = random.Below( int(movesv.size()) );
    Reversi::index_type best_move = movesv[m];
 
    if ( _verbose )
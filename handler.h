@@ -4,9 +4,16 @@
 #include "reversi.h"
 #include "nn.h"
 #include "population.h"
+#include "accumulator.h"
+#include "workspace.h"
+#include "patterns.h"
+#include "random.h"
+#include "qnn.h"
+#include "evaluator.h"
 
 
 void PrintBoard( const Reversi::board_type& board );
+void TranslateBoardtoNN( const Reversi::board_type& board, Reversi::value_type player, NeuralNetwork::nodes_type& nn_out );
 
 class HumanHandler : public Reversi::PlayerHandler
 {
@@ -29,16 +36,40 @@ class NNComputer : public Reversi::PlayerHandler
    Population::Individual* _ind;
    bool                    _verbose;
    int                     _depth;
+   Accumulator             _acc;
+   Accumulator             _leaf_acc;
+   Accumulator*            _leaves;          // network of the leaves: _acc, or _leaf_acc when cascaded
+   const QuantizedNetwork* _qnn;             // evaluates the leaves instead, if set
+   QuantizedNetwork::Context  _qctx;
+   NeuralNetwork::nodes_type  _qinput;
+   const PatternTable*     _patterns;        // evaluates the leaves instead, if set
+   bool                    _heuristic;       // evaluates the leaves by HeuristicEvaluator instead, if set
+   SearchWorkspace         _ws;
+
+   NeuralNetwork::nodes_type  _root_sums;       // first layer sums of each root move
+   NeuralNetwork::nodes_type  _root_out;        // evaluation of each root move
+   NeuralNetwork::nodes_type  _root_scratch;
 
 private:
-   Reversi::index_type BestMove( const Reversi::board_type& board, Reversi::move_list& moves, int depth );
-   NeuralNetwork::value_type MinMove( const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth );
-   NeuralNetwork::value_type MaxMove( const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth );
+   void Reserve();
+   void OrderRootMoves( const Reversi::board_type& board, Reversi::move_list& moves );
+
+   // the search, compiled for each leaf evaluator E (see evaluator.h)
+   template< class E >
+   Reversi::index_type BestMove( E& eval, const Reversi::board_type& board, Reversi::move_list& moves, int depth );
+   template< class E >
+   NeuralNetwork::value_type MinMove( E& eval, const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth );
+   template< class E >
+   NeuralNetwork::value_type MaxMove( E& eval, const Reversi::board_type& board, NeuralNetwork::value_type alpha, NeuralNetwork::value_type beta, int depth );
 
 public:
    NNComputer( bool v );
    void SetDepth( int d );
    void SetNN( Population::Individual* nind );
+   void SetLeafNN( const NeuralNetwork* nn );
+   void SetQuantized( const QuantizedNetwork* qnn );
+   void SetPatterns( const PatternTable* patterns );
+   void SetHeuristic( bool heuristic );
    void SetColor( Reversi::value_type col );
    Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves );
 };
@@ -50,10 +81,25 @@ class RandomComputer : public Reversi::PlayerHandler
    Reversi::value_type     _opp_color;
    std::string             _colorstr;
    bool                    _verbose;
+   RandomStream*           _random;          // stream of the moves, 0 for the thread's
 
 public:
    RandomComputer( bool v );
    void SetColor( Reversi::value_type col );
+   void SetStream( RandomStream* random );
+   Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves );
+};
+
+
+// Plays at random while fewer than 'plies' moves have been made in the game, then leaves
+// the moves to 'handler'. Used to vary games between deterministic players.
+class RandomOpening : public Reversi::PlayerHandler
+{
+   Reversi::PlayerHandler* _handler;
+   int                     _plies;
+
+public:
+   RandomOpening( Reversi::PlayerHandler* handler, int plies );
    Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves );
 };
 
@@ -0,0 +1,371 @@
+#include "lib.h"
+#include "island.h"
+#include "checkpoint.h"
+#include "popfile.h"
+#include "threadpool.h"
+#include "random.h"
+#include <chrono>
+#include <map>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+const int ISLAND_INTERVAL     = 5;       // generations between migrations
+const int ISLAND_MIGRANTS     = 2;       // individuals sent each time
+const int ISLAND_RESTARTS     = 3;       // times an island is started again after dying
+const int ISLAND_WAIT         = 600;     // seconds an island waits for its migrants
+const int ISLAND_PAIRINGS     = 100;     // round robin pairings between two checkpoints
+const int ISLAND_POLL_MS      = 200;     // coordinator
+
+// files of an island, in its directory
+const char* ISLAND_POP        = "current.pop";
+const char* ISLAND_PREV_POP   = "prev.pop";
+const char* ISLAND_PROGRESS   = "progress.txt";
+const char* ISLAND_GAME_LOG   = "games.log";
+const char* ISLAND_STATS      = "stats.txt";
+const char* ISLAND_LOG        = "island.log";
+const char* ISLAND_CONF       = "nn.conf";
+
+// A line of an island's stats file: the results of its last generation before a migration.
+struct IslandReport
+{
+   int island;
+   Population::GenerationStats stats;
+   int games;                 // since the last report
+   double seconds;
+   int immigrants;
+};
+
+// StartGeneration()
+// Returns the generation of the population in file 'filename', 0 if there is none.
+static int StartGeneration( const std::string& filename )
+{
+   if ( IsPopFile( filename.c_str() ) )
+   {
+      MappedPopulation file;
+      return file.Open( filename.c_str() ) ? int(file.Header().generation) : 0;
+   }
+   std::ifstream file( filename.c_str() );
+   std::string line;
+   for( int l=0; l<3; ++l )
+      if ( !std::getline( file, line ) ) return 0;
+   return atoi( line.c_str() );
+}
+
+
+Archipelago::Archipelago( const char* dir, int islands ) :
+_dir(dir), _islands(islands), _interval(ISLAND_INTERVAL), _migrants(ISLAND_MIGRANTS),
+_random_mover(false), _threads(0)
+{
+}
+
+// SetMigration()
+// Islands send 'migrants' individuals every 'interval' generations.
+void Archipelago::SetMigration( int interval, int migrants )
+{
+   _interval = std::max( interval, 1 );
+   _migrants = migrants;
+}
+
+// SetEvolution()
+// Islands evolve against the random mover if 'random_mover', else against themselves, and
+// play their games on 'threads' threads each, 0 to share the hardware threads out.
+void Archipelago::SetEvolution( bool random_mover, int threads )
+{
+   _random_mover = random_mover;
+   _threads = threads;
+}
+
+std::string Archipelago::_IslandDir( int island ) const
+{
+   std::stringstream ss;
+   ss << _dir << "/island" << island;
+   return ss.str();
+}
+
+// _MigrantFile()
+// Returns the file of the migrants of island 'island' after generation 'generation',
+// relative to the directory of an island.
+std::string Archipelago::_MigrantFile( int island, int generation ) const
+{
+   std::stringstream ss;
+   ss << "../migrants/" << island << "." << generation << ".pop";
+   return ss.str();
+}
+
+// _DeadFile()
+// Returns the file that marks island 'island' as failed for good, relative to the directory
+// of an island.
+std::string Archipelago::_DeadFile( int island ) const
+{
+   std::stringstream ss;
+   ss << "../migrants/" << island << ".dead";
+   return ss.str();
+}
+
+#ifndef _WIN32
+// _Setup()
+// Makes the directories, and clears the failures of a previous run. Islands that have no
+// population yet get a copy of the configuration file 'conf', to start a population of their own.
+bool Archipelago::_Setup( const char* conf )
+{
+   mkdir( _dir.c_str(), 0755 );
+   mkdir( (_dir + "/migrants").c_str(), 0755 );
+   for( int i=0; i<_islands; ++i )
+   {
+      std::string dir = _IslandDir( i );
+      mkdir( dir.c_str(), 0755 );
+      remove( (dir + "/" + _DeadFile( i )).c_str() );
+      std::ifstream pop( (dir + "/" + ISLAND_POP).c_str() );
+      if ( pop.is_open() ) continue;
+      std::ifstream from( conf );
+      std::ofstream to( (dir + "/" + ISLAND_CONF).c_str() );
+      if ( !from.is_open() || !(to << from.rdbuf()) )
+      {
+         std::cout << "Error in setting up island " << i << " in " << dir << " from " << conf << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+// _Start()
+// Starts the process of island 'island', to evolve it up to generation 'target'.
+// Returns its process ID, or -1.
+int Archipelago::_Start( int island, int target )
+{
+   std::cout.flush();
+   pid_t pid = fork();
+   if ( pid != 0 ) return int(pid);
+   bool ok = _Worker( island, target );
+   std::cout.flush();
+   _exit( ok ? 0 : 1 );
+}
+
+// _Fail()
+// Gives up on island 'island', and marks it so that the next island stops waiting for its migrants.
+void Archipelago::_Fail( int island ) const
+{
+   std::cout << "Island " << island << " failed" << std::endl;
+   std::ofstream dead( (_IslandDir( island ) + "/" + _DeadFile( island )).c_str() );
+   dead << "failed\n";
+}
+
+// _Worker()
+// Body of the process of island 'island': evolves its population up to generation 'target',
+// checkpointed as by -en, migrating every few generations.
+bool Archipelago::_Worker( int island, int target )
+{
+   if ( chdir( _IslandDir( island ).c_str() ) != 0 || !freopen( ISLAND_LOG, "a", stdout ) ) return false;
+   SetMasterSeed( RandomStream( MasterSeed() ).Substream( island ).Next() );
+
+   Population pop;
+   pop.SetThreads( _threads > 0 ? _threads : std::max( 1, HardwareThreads()/_islands ) );
+   pop.SetMeasure( 0 );
+   pop.SetGameLog( ISLAND_GAME_LOG );
+   if ( !pop.Load( ISLAND_POP ) ) return false;
+   pop.SetBinary( true );
+   Checkpointer checkpoint( ISLAND_POP, ISLAND_PREV_POP, ISLAND_PROGRESS );
+   pop.SetCheckpoint( &checkpoint, ISLAND_PAIRINGS );
+   pop.Resume( ISLAND_PROGRESS );
+
+   std::ofstream stats( ISLAND_STATS, std::ios::app );
+   while ( pop.GetGeneration() < target )
+   {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      int g = pop.GetGeneration();
+      int n = std::min( _interval - g % _interval, target - g );
+      int games = 0;
+      for( int k=0; k<n; ++k )
+      {
+         if ( _random_mover ) pop.EvolveRM( 1 );
+         else pop.EvolveNN( 1 );
+         games += pop.LastGeneration().games;
+      }
+
+      int immigrants = 0;
+      if ( pop.GetGeneration() % _interval == 0 && pop.GetGeneration() < target )
+      {
+         immigrants = _Migrate( pop, island );
+         if ( immigrants > 0 ) checkpoint.Save( &pop, pop.Progress( 0 ) );
+      }
+
+      const Population::GenerationStats& s = pop.LastGeneration();
+      double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      stats << s.generation << " " << s.best_id << " " << s.best_fitness << " " << s.best_games_won << " " <<
+         s.best_games_played << " " << s.mean_fitness << " " << games << " " << seconds << " " << immigrants << std::endl;
+   }
+   pop.SetCheckpoint( 0, 0 );
+   return true;
+}
+
+// _Migrate()
+// Sends the first individuals of 'pop', the parents of its last generation, to the next island
+// and replaces its last ones by those of the previous island, waiting for them if need be,
+// unless that island has failed for good. Returns the number of immigrants.
+int Archipelago::_Migrate( Population& pop, int island )
+{
+   int g = pop.GetGeneration();
+   Population emigrants = pop;
+   emigrants.SetCheckpoint( 0, 0 );
+   emigrants.Truncate( _migrants );
+   emigrants.SetBinary( true );
+   std::string to = _MigrantFile( island, g ), tmp = to + ".tmp";
+   if ( !emigrants.Save( tmp.c_str() ) || !ReplaceFile( tmp.c_str(), to.c_str(), 0 ) )
+      std::cout << "Error in writing migrants: " << to << std::endl;
+
+   int source = (island+_islands-1) % _islands;
+   std::string from = _MigrantFile( source, g ), dead = _DeadFile( source );
+   for( int waited=0; !std::ifstream( from.c_str() ).is_open(); waited+=ISLAND_POLL_MS )
+   {
+      if ( std::ifstream( dead.c_str() ).is_open() )
+      {
+         std::cout << "No migrants from island " << source << ", which failed" << std::endl;
+         return 0;
+      }
+      if ( waited >= ISLAND_WAIT*1000 )
+      {
+         std::cout << "No migrants in " << from << std::endl;
+         return 0;
+      }
+      usleep( ISLAND_POLL_MS*1000 );
+   }
+   Population migrants;
+   if ( !migrants.Load( from.c_str() ) || !pop.Immigrate( migrants ) )
+   {
+      std::cout << "Error in reading migrants: " << from << std::endl;
+      return 0;
+   }
+   remove( from.c_str() );
+   std::cout << "Received " << migrants.GetSize() << " migrants from " << from << std::endl;
+   return migrants.GetSize();
+}
+
+// Run()
+// Evolves every island for 'generations' generations, starting the islands that have no
+// population yet from the configuration file 'conf'. Reports the islands' results after
+// each migration interval as they come in, and the best of all islands once they all have.
+// Returns true if no island failed for good.
+bool Archipelago::Run( int generations, const char* conf )
+{
+   using std::cout;
+   if ( !_Setup( conf ) ) return false;
+   cout << "Evolving " << _islands << " islands in " << _dir << " for " << generations << " generations, " <<
+      _migrants << " migrants every " << _interval << " generations\n";
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   std::vector<int> target( _islands ), pid( _islands ), restarts( _islands, 0 );
+   std::vector<bool> failed( _islands, false );
+   std::vector<std::streamoff> read( _islands, 0 );
+   int restarted = 0, live = _islands;
+   for( int i=0; i<_islands; ++i )
+   {
+      std::string dir = _IslandDir( i );
+      target[i] = StartGeneration( dir + "/" + ISLAND_POP ) + generations;
+      std::ifstream stats( (dir + "/" + ISLAND_STATS).c_str(), std::ios::ate );
+      if ( stats.is_open() ) read[i] = stats.tellg();
+      pid[i] = _Start( i, target[i] );
+      if ( pid[i] < 0 )
+      {
+         _Fail( i );
+         failed[i] = true;
+         live--;
+      }
+   }
+
+   cout << "island\tgen\tbest\tfitness\twon\tgames\tmean\tgames\tsec\tmigrants\n";
+   cout << "----------------------------------------------------------------------------\n";
+   std::map< int, std::vector<IslandReport> > reports;    // by generation
+   long long total_games = 0, summary_games = 0;
+   for( bool polling = true; polling; )
+   {
+      polling = live > 0;
+      if ( polling ) usleep( ISLAND_POLL_MS*1000 );
+
+      // islands that stopped
+      int status;
+      pid_t done;
+      while ( live > 0 && (done = waitpid( -1, &status, WNOHANG )) > 0 )
+      {
+         int i = int( std::find( pid.begin(), pid.end(), int(done) ) - pid.begin() );
+         if ( i == _islands ) continue;
+         if ( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 )
+         {
+            live--;
+            continue;
+         }
+         if ( restarts[i] < ISLAND_RESTARTS )
+         {
+            cout << "Island " << i << " stopped, starting it again from its checkpoint" << std::endl;
+            restarts[i]++;
+            restarted++;
+            pid[i] = _Start( i, target[i] );
+            if ( pid[i] >= 0 ) continue;
+         }
+         _Fail( i );
+         failed[i] = true;
+         live--;
+      }
+
+      // new results
+      for( int i=0; i<_islands; ++i )
+      {
+         std::ifstream stats( (_IslandDir( i ) + "/" + ISLAND_STATS).c_str() );
+         if ( !stats.is_open() ) continue;
+         stats.seekg( read[i] );
+         std::string line;
+         while ( std::getline( stats, line ) && !stats.eof() )
+         {
+            read[i] = stats.tellg();
+            IslandReport r;
+            Population::GenerationStats& s = r.stats;
+            std::stringstream ss( line );
+            r.island = i;
+            if ( !(ss >> s.generation >> s.best_id >> s.best_fitness >> s.best_games_won >> s.best_games_played >>
+                   s.mean_fitness >> r.games >> r.seconds >> r.immigrants) ) continue;
+            total_games += r.games;
+            reports[s.generation].push_back( r );
+            cout << i << "\t" << s.generation << "\t" << s.best_id << "\t" << s.best_fitness << "\t" <<
+               s.best_games_won << "\t" << s.best_games_played << "\t" << s.mean_fitness << "\t" << r.games << "\t" <<
+               r.seconds << "\t" << r.immigrants << "\n";
+         }
+      }
+
+      // generations all islands have reported, or all that are left at the end
+      int healthy = int( std::count( failed.begin(), failed.end(), false ) );
+      while ( !reports.empty() && ( int(reports.begin()->second.size()) >= healthy || !polling ) )
+      {
+         const std::vector<IslandReport>& rs = reports.begin()->second;
+         int best = 0;
+         double mean = 0.0;
+         for( unsigned int k=0; k<rs.size(); ++k )
+         {
+            summary_games += rs[k].games;
+            mean += rs[k].stats.mean_fitness/rs.size();
+            const Population::GenerationStats& s = rs[k].stats, & b = rs[best].stats;
+            if ( s.best_fitness > b.best_fitness || ( s.best_fitness == b.best_fitness && rs[k].island < rs[best].island ) )
+               best = k;
+         }
+         double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+         cout << "all\t" << reports.begin()->first << "\t" << rs[best].stats.best_id << "@" << rs[best].island << "\t" <<
+            rs[best].stats.best_fitness << "\t\t\t" << mean << "\t" << summary_games << "\t" << secs << "\n";
+         reports.erase( reports.begin() );
+      }
+      cout.flush();
+   }
+
+   double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+   int lost = int( std::count( failed.begin(), failed.end(), true ) );
+   cout << "Islands complete: " << total_games << " games in " << secs << "s (" << total_games/std::max( secs, 1e-9 ) <<
+      " games/s), " << restarted << " restarts, " << lost << " failed" << std::endl;
+   return lost == 0;
+}
+#else
+bool Archipelago::Run( int, const char* )
+{
+   std::cout << "Islands need fork(), which this platform does not have." << std::endl;
+   return false;
+}
+#endif
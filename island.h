@@ -0,0 +1,48 @@
+#ifndef ALNITE_ISLAND_H_
+#define ALNITE_ISLAND_H_
+
+#include "population.h"
+
+// Island model. Worker processes each evolve a population of their own, in a directory of
+// their own, and every few generations send copies of their best individuals to the next
+// island of a ring, where they replace the worst ones. Migrants travel as population files
+// through a shared directory, so islands need nothing but a file system in common, and an
+// island that dies costs only its own work since its last checkpoint: the coordinator starts
+// it again from there. Each island appends a line of results to its stats file after every
+// migration interval, which the coordinator gathers into a report.
+//
+// Directory layout:
+//   island<I>/     island I, with the files of a single population: current.pop, prev.pop,
+//                  progress.txt and games.log, plus stats.txt and island.log, its output
+//   migrants/      <I>.<GENERATION>.pop, the migrants island I sent after that generation, and
+//                  <I>.dead once island I has failed for good, so the next one stops waiting
+class Archipelago
+{
+   std::string _dir;
+   int         _islands;
+   int         _interval;        // generations between migrations
+   int         _migrants;        // individuals sent each time
+   bool        _random_mover;    // islands evolve against the random mover, else against themselves
+   int         _threads;         // per island, 0 to share the hardware threads out
+
+   std::string _IslandDir( int island ) const;
+   std::string _MigrantFile( int island, int generation ) const;
+   std::string _DeadFile( int island ) const;
+   bool _Setup( const char* conf );
+   int _Start( int island, int target );
+   void _Fail( int island ) const;
+   bool _Worker( int island, int target );
+   int _Migrate( Population& pop, int island );
+
+   Archipelago( const Archipelago& );
+   Archipelago& operator=( const Archipelago& );
+
+public:
+   Archipelago( const char* dir, int islands );
+
+   void SetMigration( int interval, int migrants );
+   void SetEvolution( bool random_mover, int threads );
+   bool Run( int generations, const char* conf );
+};
+
+#endif
@@ -0,0 +1,775 @@
+#include "lib.h"
+#include "kernel.h"
+#include "random.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// GCC warns that the undefined vector some of its intrinsics start from may be used
+// uninitialized, in every kernel they are inlined into. The kernels that use them are
+// wrapped in these.
+#if defined(KERNEL_X86) && !defined(__clang__)
+#define KERNEL_UNINIT_BEGIN _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+#define KERNEL_UNINIT_END   _Pragma("GCC diagnostic pop")
+#else
+#define KERNEL_UNINIT_BEGIN
+#define KERNEL_UNINIT_END
+#endif
+
+
+// ----------------- PORTABLE -----------------
+static void GemvScalar( const double* w, const double* in, double* out, int rows, int cols )
+{
+   for( int r=0; r<rows; ++r )
+   {
+      double sum = 0.0;
+      for( int c=0; c<cols; ++c )
+         sum += in[c] * w[c];
+      out[r] = sum;
+      w += cols;
+   }
+}
+
+static void SigmoidScalar( double* v, int n )
+{
+   for( int i=0; i<n; ++i )
+      v[i] = 1.0/(1.0+exp(-v[i]));
+}
+
+// Gemm() works on tiles of GEMM_COLS columns by GEMM_BATCH inputs, so that the weights and the
+// inputs of a tile stay in cache while every row of the tile is computed.
+const int GEMM_COLS  = 256;
+const int GEMM_BATCH = 16;
+
+static void GemmScalar( const double* w, const double* in, double* out, int count, int rows, int cols )
+{
+   for( int i=0; i<count*rows; ++i ) out[i] = 0.0;
+   for( int c0=0; c0<cols; c0+=GEMM_COLS )
+   {
+      int c1 = std::min( cols, c0+GEMM_COLS );
+      for( int b0=0; b0<count; b0+=GEMM_BATCH )
+      {
+         int b1 = std::min( count, b0+GEMM_BATCH );
+         for( int r=0; r<rows; ++r )
+         {
+            const double* wr = w + r*cols;
+            for( int b=b0; b<b1; ++b )
+            {
+               const double* x = in + b*cols;
+               double sum = 0.0;
+               for( int c=c0; c<c1; ++c )
+                  sum += wr[c] * x[c];
+               out[b*rows+r] += sum;
+            }
+         }
+      }
+   }
+}
+
+// Sigmoid table for ACTIVATION_TABLE, TABLE_STEPS entries per unit over [-TABLE_RANGE,TABLE_RANGE],
+// plus one so that interpolation never reads past the end.
+const double TABLE_RANGE = 16.0;
+const int    TABLE_STEPS = 32;
+const int    TABLE_SIZE  = int(2*TABLE_RANGE)*TABLE_STEPS + 2;
+
+static const double* SigmoidTable()
+{
+   static std::vector<double> table;
+   if ( table.empty() )
+   {
+      table.resize( TABLE_SIZE );
+      for( int i=0; i<TABLE_SIZE; ++i )
+         table[i] = 1.0/(1.0+exp(TABLE_RANGE - double(i)/TABLE_STEPS));
+   }
+   return &table[0];
+}
+
+static const double* sigmoid_table = SigmoidTable();
+
+// Pade approximation of tanh(y), exact to 1 at |y| = PADE_LIMIT
+const double PADE_LIMIT = 4.97;
+
+static void TableScalar( double* v, int n )
+{
+   const double last = 2*TABLE_RANGE*TABLE_STEPS;
+   for( int i=0; i<n; ++i )
+   {
+      double x = (v[i] + TABLE_RANGE) * TABLE_STEPS;
+      x = ( x < 0.0 ) ? 0.0 : ( x > last ) ? last : x;
+      int j = int(x);
+      double f = x - j;
+      v[i] = sigmoid_table[j] + f*(sigmoid_table[j+1]-sigmoid_table[j]);
+   }
+}
+
+static void RationalScalar( double* v, int n )
+{
+   for( int i=0; i<n; ++i )
+   {
+      double y = 0.5*v[i];
+      y = ( y < -PADE_LIMIT ) ? -PADE_LIMIT : ( y > PADE_LIMIT ) ? PADE_LIMIT : y;
+      double y2 = y*y;
+      double t = y*(135135.0 + y2*(17325.0 + y2*(378.0 + y2))) / (135135.0 + y2*(62370.0 + y2*(3150.0 + y2*28.0)));
+      v[i] = 0.5 + 0.5*t;
+   }
+}
+
+static void HardScalar( double* v, int n )
+{
+   for( int i=0; i<n; ++i )
+   {
+      double y = 0.25*v[i] + 0.5;
+      v[i] = ( y < 0.0 ) ? 0.0 : ( y > 1.0 ) ? 1.0 : y;
+   }
+}
+
+static void SumRowsScalar( const double* table, const int* rows, int count, double* out, int n )
+{
+   for( int k=0; k<count; ++k )
+   {
+      const double* row = table + rows[k]*n;
+      for( int i=0; i<n; ++i )
+         out[i] += row[i];
+   }
+}
+
+static void GemvInt8Scalar( const signed char* w, const short* in, int* out, int rows, int cols )
+{
+   for( int r=0; r<rows; ++r )
+   {
+      int sum = 0;
+      for( int c=0; c<cols; ++c )
+         sum += in[c] * w[c];
+      out[r] = sum;
+      w += cols;
+   }
+}
+
+static void HashScalar( uint64_t key, uint64_t first, uint64_t* out, int n )
+{
+   RandomStream s( key );
+   for( int i=0; i<n; ++i )
+      out[i] = s.At( first+i );
+}
+
+static void MutateScalar( const double* sa, const double* g, double taup, double step, double* child_sa, double* delta, int n )
+{
+   for( int i=0; i<n; ++i )
+   {
+      child_sa[i] = sa[i] * exp( taup*g[i]+step );
+      delta[i] = child_sa[i]*g[i];
+   }
+}
+
+
+#ifdef KERNEL_X86
+// exp() for the vector kernels: x = n*ln2 + r with |r| <= ln2/2, exp(r) by a degree 12
+// Taylor polynomial (relative error below 1e-15), then 2^n is added to the exponent bits.
+const double EXP_MAX      = 708.0;
+const double EXP_LOG2E    = 1.4426950408889634;
+const double EXP_LN2_HI   = 6.93145751953125e-1;
+const double EXP_LN2_LO   = 1.42860682030941723212e-6;
+const double EXP_MAGIC    = 6755399441055744.0;      // 1.5 * 2^52
+const double EXP_COEF[13] =
+{
+   1.0/479001600.0, 1.0/39916800.0, 1.0/3628800.0, 1.0/362880.0, 1.0/40320.0, 1.0/5040.0,
+   1.0/720.0, 1.0/120.0, 1.0/24.0, 1.0/6.0, 1.0/2.0, 1.0, 1.0
+};
+
+
+// ----------------- AVX2 / FMA -----------------
+__attribute__((target("avx2,fma")))
+static inline double HorizontalSumAVX2( __m256d v )
+{
+   __m128d lo = _mm256_castpd256_pd128(v);
+   __m128d hi = _mm256_extractf128_pd(v, 1);
+   lo = _mm_add_pd(lo, hi);
+   return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+static void GemvAVX2( const double* w, const double* in, double* out, int rows, int cols )
+{
+   int c4 = cols & ~3;
+   int r = 0;
+   // four rows at a time share the loads of 'in'
+   for( ; r+4<=rows; r+=4 )
+   {
+      const double* w0 = w; const double* w1 = w0+cols; const double* w2 = w1+cols; const double* w3 = w2+cols;
+      __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+      __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+      for( int c=0; c<c4; c+=4 )
+      {
+         __m256d x = _mm256_loadu_pd(in+c);
+         a0 = _mm256_fmadd_pd(_mm256_loadu_pd(w0+c), x, a0);
+         a1 = _mm256_fmadd_pd(_mm256_loadu_pd(w1+c), x, a1);
+         a2 = _mm256_fmadd_pd(_mm256_loadu_pd(w2+c), x, a2);
+         a3 = _mm256_fmadd_pd(_mm256_loadu_pd(w3+c), x, a3);
+      }
+      double s0 = HorizontalSumAVX2(a0), s1 = HorizontalSumAVX2(a1);
+      double s2 = HorizontalSumAVX2(a2), s3 = HorizontalSumAVX2(a3);
+      for( int c=c4; c<cols; ++c )
+      {
+         s0 += in[c]*w0[c]; s1 += in[c]*w1[c]; s2 += in[c]*w2[c]; s3 += in[c]*w3[c];
+      }
+      out[r] = s0; out[r+1] = s1; out[r+2] = s2; out[r+3] = s3;
+      w += 4*cols;
+   }
+   for( ; r<rows; ++r )
+   {
+      __m256d a = _mm256_setzero_pd();
+      for( int c=0; c<c4; c+=4 )
+         a = _mm256_fmadd_pd(_mm256_loadu_pd(w+c), _mm256_loadu_pd(in+c), a);
+      double s = HorizontalSumAVX2(a);
+      for( int c=c4; c<cols; ++c )
+         s += in[c]*w[c];
+      out[r] = s;
+      w += cols;
+   }
+}
+
+// Gemm() micro kernel: 4 rows by 2 inputs over columns [c0,c1), added to 'out'
+__attribute__((target("avx2,fma")))
+static inline void GemmBlockAVX2( const double* w, const double* in, double* out, int b, int r, int rows, int cols, int c0, int c1 )
+{
+   const double* w0 = w + r*cols; const double* w1 = w0+cols; const double* w2 = w1+cols; const double* w3 = w2+cols;
+   const double* x0 = in + b*cols; const double* x1 = x0+cols;
+   __m256d a00 = _mm256_setzero_pd(), a01 = _mm256_setzero_pd(), a02 = _mm256_setzero_pd(), a03 = _mm256_setzero_pd();
+   __m256d a10 = _mm256_setzero_pd(), a11 = _mm256_setzero_pd(), a12 = _mm256_setzero_pd(), a13 = _mm256_setzero_pd();
+   int c = c0;
+   for( ; c+4<=c1; c+=4 )
+   {
+      __m256d v0 = _mm256_loadu_pd(w0+c), v1 = _mm256_loadu_pd(w1+c);
+      __m256d v2 = _mm256_loadu_pd(w2+c), v3 = _mm256_loadu_pd(w3+c);
+      __m256d y0 = _mm256_loadu_pd(x0+c), y1 = _mm256_loadu_pd(x1+c);
+      a00 = _mm256_fmadd_pd(v0, y0, a00); a01 = _mm256_fmadd_pd(v1, y0, a01);
+      a02 = _mm256_fmadd_pd(v2, y0, a02); a03 = _mm256_fmadd_pd(v3, y0, a03);
+      a10 = _mm256_fmadd_pd(v0, y1, a10); a11 = _mm256_fmadd_pd(v1, y1, a11);
+      a12 = _mm256_fmadd_pd(v2, y1, a12); a13 = _mm256_fmadd_pd(v3, y1, a13);
+   }
+   double s[8] =
+   {
+      HorizontalSumAVX2(a00), HorizontalSumAVX2(a01), HorizontalSumAVX2(a02), HorizontalSumAVX2(a03),
+      HorizontalSumAVX2(a10), HorizontalSumAVX2(a11), HorizontalSumAVX2(a12), HorizontalSumAVX2(a13)
+   };
+   for( ; c<c1; ++c )
+   {
+      s[0] += w0[c]*x0[c]; s[1] += w1[c]*x0[c]; s[2] += w2[c]*x0[c]; s[3] += w3[c]*x0[c];
+      s[4] += w0[c]*x1[c]; s[5] += w1[c]*x1[c]; s[6] += w2[c]*x1[c]; s[7] += w3[c]*x1[c];
+   }
+   double* o0 = out + b*rows + r; double* o1 = o0 + rows;
+   o0[0] += s[0]; o0[1] += s[1]; o0[2] += s[2]; o0[3] += s[3];
+   o1[0] += s[4]; o1[1] += s[5]; o1[2] += s[6]; o1[3] += s[7];
+}
+
+__attribute__((target("avx2,fma")))
+static void GemmAVX2( const double* w, const double* in, double* out, int count, int rows, int cols )
+{
+   int r4 = rows & ~3, b2 = count & ~1;
+   for( int i=0; i<count*rows; ++i ) out[i] = 0.0;
+   for( int c0=0; c0<cols; c0+=GEMM_COLS )
+   {
+      int c1 = std::min( cols, c0+GEMM_COLS );
+      for( int bt=0; bt<count; bt+=GEMM_BATCH )
+      {
+         int be = std::min( b2, bt+GEMM_BATCH );
+         for( int r=0; r<r4; r+=4 )
+            for( int b=bt; b<be; b+=2 )
+               GemmBlockAVX2( w, in, out, b, r, rows, cols, c0, c1 );
+      }
+
+      // rows and inputs left over from the 4x2 blocks
+      for( int b=0; b<count; ++b )
+         for( int r=(b < b2) ? r4 : 0; r<rows; ++r )
+         {
+            double sum = 0.0;
+            for( int c=c0; c<c1; ++c )
+               sum += w[r*cols+c] * in[b*cols+c];
+            out[b*rows+r] += sum;
+         }
+   }
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d ExpAVX2( __m256d x )
+{
+   x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-EXP_MAX)), _mm256_set1_pd(EXP_MAX));
+   __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+   __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(EXP_LN2_HI), x);
+   r = _mm256_fnmadd_pd(n, _mm256_set1_pd(EXP_LN2_LO), r);
+
+   __m256d p = _mm256_set1_pd(EXP_COEF[0]);
+   for( int i=1; i<13; ++i )
+      p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(EXP_COEF[i]));
+
+   __m256d magic = _mm256_set1_pd(EXP_MAGIC);
+   __m256i e = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)), _mm256_castpd_si256(magic));
+   e = _mm256_slli_epi64(e, 52);
+   return _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(p), e));
+}
+
+__attribute__((target("avx2,fma")))
+static void SigmoidAVX2( double* v, int n )
+{
+   __m256d one = _mm256_set1_pd(1.0);
+   __m256d zero = _mm256_setzero_pd();
+   int i = 0;
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256d x = _mm256_loadu_pd(v+i);
+      __m256d e = ExpAVX2(_mm256_sub_pd(zero, x));
+      _mm256_storeu_pd(v+i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+   }
+   for( ; i<n; ++i )
+      v[i] = 1.0/(1.0+exp(-v[i]));
+}
+
+
+KERNEL_UNINIT_BEGIN
+__attribute__((target("avx2,fma")))
+static void TableAVX2( double* v, int n )
+{
+   __m256d offset = _mm256_set1_pd(TABLE_RANGE), steps = _mm256_set1_pd(TABLE_STEPS);
+   __m256d lo = _mm256_setzero_pd(), hi = _mm256_set1_pd(2*TABLE_RANGE*TABLE_STEPS);
+   int i = 0;
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256d x = _mm256_mul_pd(_mm256_add_pd(_mm256_loadu_pd(v+i), offset), steps);
+      x = _mm256_min_pd(_mm256_max_pd(x, lo), hi);
+      __m128i j = _mm256_cvttpd_epi32(x);
+      __m256d f = _mm256_sub_pd(x, _mm256_cvtepi32_pd(j));
+      __m256d a = _mm256_i32gather_pd(sigmoid_table, j, 8);
+      __m256d b = _mm256_i32gather_pd(sigmoid_table+1, j, 8);
+      _mm256_storeu_pd(v+i, _mm256_fmadd_pd(f, _mm256_sub_pd(b, a), a));
+   }
+   TableScalar( v+i, n-i );
+}
+KERNEL_UNINIT_END
+
+__attribute__((target("avx2,fma")))
+static void RationalAVX2( double* v, int n )
+{
+   __m256d half = _mm256_set1_pd(0.5);
+   __m256d lim = _mm256_set1_pd(PADE_LIMIT), nlim = _mm256_set1_pd(-PADE_LIMIT);
+   int i = 0;
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256d y = _mm256_mul_pd(_mm256_loadu_pd(v+i), half);
+      y = _mm256_min_pd(_mm256_max_pd(y, nlim), lim);
+      __m256d y2 = _mm256_mul_pd(y, y);
+      __m256d p = _mm256_add_pd(y2, _mm256_set1_pd(378.0));
+      p = _mm256_fmadd_pd(p, y2, _mm256_set1_pd(17325.0));
+      p = _mm256_fmadd_pd(p, y2, _mm256_set1_pd(135135.0));
+      p = _mm256_mul_pd(p, y);
+      __m256d q = _mm256_fmadd_pd(y2, _mm256_set1_pd(28.0), _mm256_set1_pd(3150.0));
+      q = _mm256_fmadd_pd(q, y2, _mm256_set1_pd(62370.0));
+      q = _mm256_fmadd_pd(q, y2, _mm256_set1_pd(135135.0));
+      _mm256_storeu_pd(v+i, _mm256_fmadd_pd(_mm256_div_pd(p, q), half, half));
+   }
+   RationalScalar( v+i, n-i );
+}
+
+__attribute__((target("avx2,fma")))
+static void HardAVX2( double* v, int n )
+{
+   __m256d q = _mm256_set1_pd(0.25), half = _mm256_set1_pd(0.5);
+   __m256d lo = _mm256_setzero_pd(), hi = _mm256_set1_pd(1.0);
+   int i = 0;
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256d y = _mm256_fmadd_pd(_mm256_loadu_pd(v+i), q, half);
+      _mm256_storeu_pd(v+i, _mm256_min_pd(_mm256_max_pd(y, lo), hi));
+   }
+   HardScalar( v+i, n-i );
+}
+
+
+// 16 outputs at a time stay in registers while all the rows are added.
+__attribute__((target("avx2,fma")))
+static void SumRowsAVX2( const double* table, const int* rows, int count, double* out, int n )
+{
+   int i = 0;
+   for( ; i+16<=n; i+=16 )
+   {
+      __m256d a0 = _mm256_loadu_pd(out+i),    a1 = _mm256_loadu_pd(out+i+4);
+      __m256d a2 = _mm256_loadu_pd(out+i+8),  a3 = _mm256_loadu_pd(out+i+12);
+      for( int k=0; k<count; ++k )
+      {
+         const double* row = table + rows[k]*n + i;
+         a0 = _mm256_add_pd(a0, _mm256_loadu_pd(row));
+         a1 = _mm256_add_pd(a1, _mm256_loadu_pd(row+4));
+         a2 = _mm256_add_pd(a2, _mm256_loadu_pd(row+8));
+         a3 = _mm256_add_pd(a3, _mm256_loadu_pd(row+12));
+      }
+      _mm256_storeu_pd(out+i, a0);    _mm256_storeu_pd(out+i+4, a1);
+      _mm256_storeu_pd(out+i+8, a2);  _mm256_storeu_pd(out+i+12, a3);
+   }
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256d a = _mm256_loadu_pd(out+i);
+      for( int k=0; k<count; ++k )
+         a = _mm256_add_pd(a, _mm256_loadu_pd(table + rows[k]*n + i));
+      _mm256_storeu_pd(out+i, a);
+   }
+   for( ; i<n; ++i )
+      for( int k=0; k<count; ++k )
+         out[i] += table[rows[k]*n + i];
+}
+
+
+// int8 weights are widened to int16 and multiplied by the int16 inputs in pairs,
+// 16 products per instruction.
+__attribute__((target("avx2")))
+static void GemvInt8AVX2( const signed char* w, const short* in, int* out, int rows, int cols )
+{
+   int c16 = cols & ~15;
+   for( int r=0; r<rows; ++r )
+   {
+      __m256i a = _mm256_setzero_si256();
+      for( int c=0; c<c16; c+=16 )
+      {
+         __m256i wv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w+c)));
+         __m256i x = _mm256_loadu_si256((const __m256i*)(in+c));
+         a = _mm256_add_epi32(a, _mm256_madd_epi16(wv, x));
+      }
+      __m128i s = _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+      int sum = _mm_cvtsi128_si32(s);
+      for( int c=c16; c<cols; ++c )
+         sum += in[c] * w[c];
+      out[r] = sum;
+      w += cols;
+   }
+}
+
+
+// HashVector() and MutateVector() follow RandomStream::At() and MutateScalar() step by step.
+// AVX2 has no 64-bit multiply: it is put together from 32-bit ones. Their tails are finished
+// in place rather than by a tail call to the scalar kernel, which would skip the vzeroupper
+// on return and slow down the scalar code that follows.
+const uint64_t HASH_GAMMA = 0x9e3779b97f4a7c15ULL;
+const uint64_t HASH_MUL1  = 0xbf58476d1ce4e5b9ULL;
+const uint64_t HASH_MUL2  = 0x94d049bb133111ebULL;
+
+__attribute__((target("avx2")))
+static inline __m256i Mul64AVX2( __m256i a, __m256i b )
+{
+   __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                    _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+   return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i MixAVX2( __m256i z )
+{
+   z = Mul64AVX2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), _mm256_set1_epi64x(HASH_MUL1));
+   z = Mul64AVX2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), _mm256_set1_epi64x(HASH_MUL2));
+   return z;
+}
+
+__attribute__((target("avx2")))
+static void HashAVX2( uint64_t key, uint64_t first, uint64_t* out, int n )
+{
+   __m256i k = _mm256_set1_epi64x(key);
+   __m256i z0 = _mm256_set_epi64x(key + (first+3)*HASH_GAMMA, key + (first+2)*HASH_GAMMA,
+                                  key + (first+1)*HASH_GAMMA, key + first*HASH_GAMMA);
+   __m256i step = _mm256_set1_epi64x(4*HASH_GAMMA);
+   int i = 0;
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256i z = MixAVX2(z0);
+      z = _mm256_xor_si256(_mm256_xor_si256(z, _mm256_srli_epi64(z, 31)), k);
+      z = MixAVX2(z);
+      z = _mm256_xor_si256(z, _mm256_srli_epi64(z, 31));
+      _mm256_storeu_si256((__m256i*)(out+i), z);
+      z0 = _mm256_add_epi64(z0, step);
+   }
+   RandomStream tail( key );
+   for( ; i<n; ++i )
+      out[i] = tail.At( first+i );
+}
+
+__attribute__((target("avx2,fma")))
+static void MutateAVX2( const double* sa, const double* g, double taup, double step, double* child_sa, double* delta, int n )
+{
+   __m256d t = _mm256_set1_pd(taup), s = _mm256_set1_pd(step);
+   int i = 0;
+   for( ; i+4<=n; i+=4 )
+   {
+      __m256d gv = _mm256_loadu_pd(g+i);
+      __m256d c = _mm256_mul_pd(_mm256_loadu_pd(sa+i), ExpAVX2(_mm256_fmadd_pd(t, gv, s)));
+      _mm256_storeu_pd(child_sa+i, c);
+      _mm256_storeu_pd(delta+i, _mm256_mul_pd(c, gv));
+   }
+   for( ; i<n; ++i )
+   {
+      child_sa[i] = sa[i] * exp( taup*g[i]+step );
+      delta[i] = child_sa[i]*g[i];
+   }
+}
+
+
+// ----------------- AVX-512 -----------------
+KERNEL_UNINIT_BEGIN
+__attribute__((target("avx512f")))
+static void GemvAVX512( const double* w, const double* in, double* out, int rows, int cols )
+{
+   int c8 = cols & ~7;
+   __mmask8 tail = (__mmask8)((1u << (cols & 7)) - 1);
+   int r = 0;
+   for( ; r+4<=rows; r+=4 )
+   {
+      const double* w0 = w; const double* w1 = w0+cols; const double* w2 = w1+cols; const double* w3 = w2+cols;
+      __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+      __m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+      for( int c=0; c<c8; c+=8 )
+      {
+         __m512d x = _mm512_loadu_pd(in+c);
+         a0 = _mm512_fmadd_pd(_mm512_loadu_pd(w0+c), x, a0);
+         a1 = _mm512_fmadd_pd(_mm512_loadu_pd(w1+c), x, a1);
+         a2 = _mm512_fmadd_pd(_mm512_loadu_pd(w2+c), x, a2);
+         a3 = _mm512_fmadd_pd(_mm512_loadu_pd(w3+c), x, a3);
+      }
+      if ( tail )
+      {
+         __m512d x = _mm512_maskz_loadu_pd(tail, in+c8);
+         a0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w0+c8), x, a0);
+         a1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w1+c8), x, a1);
+         a2 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w2+c8), x, a2);
+         a3 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w3+c8), x, a3);
+      }
+      out[r] = _mm512_reduce_add_pd(a0); out[r+1] = _mm512_reduce_add_pd(a1);
+      out[r+2] = _mm512_reduce_add_pd(a2); out[r+3] = _mm512_reduce_add_pd(a3);
+      w += 4*cols;
+   }
+   for( ; r<rows; ++r )
+   {
+      __m512d a = _mm512_setzero_pd();
+      for( int c=0; c<c8; c+=8 )
+         a = _mm512_fmadd_pd(_mm512_loadu_pd(w+c), _mm512_loadu_pd(in+c), a);
+      if ( tail )
+         a = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, w+c8), _mm512_maskz_loadu_pd(tail, in+c8), a);
+      out[r] = _mm512_reduce_add_pd(a);
+      w += cols;
+   }
+}
+KERNEL_UNINIT_END
+
+__attribute__((target("avx512f")))
+static inline __m512d ExpAVX512( __m512d x )
+{
+   x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(-EXP_MAX)), _mm512_set1_pd(EXP_MAX));
+   __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(EXP_LOG2E)), _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+   __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(EXP_LN2_HI), x);
+   r = _mm512_fnmadd_pd(n, _mm512_set1_pd(EXP_LN2_LO), r);
+
+   __m512d p = _mm512_set1_pd(EXP_COEF[0]);
+   for( int i=1; i<13; ++i )
+      p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(EXP_COEF[i]));
+
+   return _mm512_scalef_pd(p, n);
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512i MixAVX512( __m512i z )
+{
+   z = _mm512_mullo_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 30)), _mm512_set1_epi64(HASH_MUL1));
+   z = _mm512_mullo_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 27)), _mm512_set1_epi64(HASH_MUL2));
+   return z;
+}
+
+KERNEL_UNINIT_BEGIN
+__attribute__((target("avx512f,avx512dq")))
+static void HashAVX512( uint64_t key, uint64_t first, uint64_t* out, int n )
+{
+   __m512i k = _mm512_set1_epi64(key);
+   __m512i z0 = _mm512_add_epi64(_mm512_set1_epi64(key + first*HASH_GAMMA),
+                                 _mm512_mullo_epi64(_mm512_set_epi64(7,6,5,4,3,2,1,0), _mm512_set1_epi64(HASH_GAMMA)));
+   __m512i step = _mm512_set1_epi64(8*HASH_GAMMA);
+   int i = 0;
+   for( ; i+8<=n; i+=8 )
+   {
+      __m512i z = MixAVX512(z0);
+      z = _mm512_xor_si512(_mm512_xor_si512(z, _mm512_srli_epi64(z, 31)), k);
+      z = MixAVX512(z);
+      z = _mm512_xor_si512(z, _mm512_srli_epi64(z, 31));
+      _mm512_storeu_si512((void*)(out+i), z);
+      z0 = _mm512_add_epi64(z0, step);
+   }
+   RandomStream tail( key );
+   for( ; i<n; ++i )
+      out[i] = tail.At( first+i );
+}
+
+__attribute__((target("avx512f")))
+static void MutateAVX512( const double* sa, const double* g, double taup, double step, double* child_sa, double* delta, int n )
+{
+   __m512d t = _mm512_set1_pd(taup), s = _mm512_set1_pd(step);
+   int i = 0;
+   for( ; i+8<=n; i+=8 )
+   {
+      __m512d gv = _mm512_loadu_pd(g+i);
+      __m512d c = _mm512_mul_pd(_mm512_loadu_pd(sa+i), ExpAVX512(_mm512_fmadd_pd(t, gv, s)));
+      _mm512_storeu_pd(child_sa+i, c);
+      _mm512_storeu_pd(delta+i, _mm512_mul_pd(c, gv));
+   }
+   for( ; i<n; ++i )
+   {
+      child_sa[i] = sa[i] * exp( taup*g[i]+step );
+      delta[i] = child_sa[i]*g[i];
+   }
+}
+KERNEL_UNINIT_END
+
+KERNEL_UNINIT_BEGIN
+__attribute__((target("avx512f")))
+static void SigmoidAVX512( double* v, int n )
+{
+   __m512d one = _mm512_set1_pd(1.0);
+   __m512d zero = _mm512_setzero_pd();
+   int i = 0;
+   for( ; i+8<=n; i+=8 )
+   {
+      __m512d x = _mm512_loadu_pd(v+i);
+      __m512d e = ExpAVX512(_mm512_sub_pd(zero, x));
+      _mm512_storeu_pd(v+i, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+   }
+   for( ; i<n; ++i )
+      v[i] = 1.0/(1.0+exp(-v[i]));
+}
+KERNEL_UNINIT_END
+#endif
+
+
+// ----------------- DISPATCH -----------------
+struct KernelTable
+{
+   const char* name;
+   void (*gemv)( const double*, const double*, double*, int, int );
+   void (*sigmoid)( double*, int );
+   void (*gemv_int8)( const signed char*, const short*, int*, int, int );
+   void (*table)( double*, int );
+   void (*rational)( double*, int );
+   void (*hard)( double*, int );
+   void (*gemm)( const double*, const double*, double*, int, int, int );
+   void (*sum_rows)( const double*, const int*, int, double*, int );
+   void (*hash)( uint64_t, uint64_t, uint64_t*, int );
+   void (*mutate)( const double*, const double*, double, double, double*, double*, int );
+};
+
+static const KernelTable KERNEL_SCALAR =
+{ "scalar", GemvScalar, SigmoidScalar, GemvInt8Scalar, TableScalar, RationalScalar, HardScalar, GemmScalar, SumRowsScalar,
+  HashScalar, MutateScalar };
+#ifdef KERNEL_X86
+static const KernelTable KERNEL_AVX2 =
+{ "avx2", GemvAVX2, SigmoidAVX2, GemvInt8AVX2, TableAVX2, RationalAVX2, HardAVX2, GemmAVX2, SumRowsAVX2,
+  HashAVX2, MutateAVX2 };
+static const KernelTable KERNEL_AVX512 =
+{ "avx512", GemvAVX512, SigmoidAVX512, GemvInt8AVX2, TableAVX2, RationalAVX2, HardAVX2, GemmAVX2, SumRowsAVX2,
+  HashAVX512, MutateAVX512 };
+#endif
+
+// DetectKernel()
+// Returns the best kernels supported by this CPU.
+static const KernelTable* DetectKernel()
+{
+#ifdef KERNEL_X86
+   __builtin_cpu_init();
+   if ( __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") ) return &KERNEL_AVX512;
+   if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) return &KERNEL_AVX2;
+#endif
+   return &KERNEL_SCALAR;
+}
+
+static const KernelTable* kernel = DetectKernel();
+
+
+void Gemv( const double* w, const double* in, double* out, int rows, int cols )
+{
+   kernel->gemv( w, in, out, rows, cols );
+}
+
+void SigmoidVector( double* v, int n )
+{
+   kernel->sigmoid( v, n );
+}
+
+void Gemm( const double* w, const double* in, double* out, int count, int rows, int cols )
+{
+   kernel->gemm( w, in, out, count, rows, cols );
+}
+
+void ActivationVector( int a, double* v, int n )
+{
+   switch( a )
+   {
+   case ACTIVATION_TABLE:     kernel->table( v, n ); break;
+   case ACTIVATION_RATIONAL:  kernel->rational( v, n ); break;
+   case ACTIVATION_HARD:      kernel->hard( v, n ); break;
+   default:                   kernel->sigmoid( v, n ); break;
+   }
+}
+
+static const char* ACTIVATION_NAMES[] = { "exact", "table", "rational", "hard" };
+
+// ActivationByName()
+// Returns the activation called 'name', or -1 if there is none.
+int ActivationByName( const char* name )
+{
+   for( int a=ACTIVATION_EXACT; a<=ACTIVATION_HARD; ++a )
+      if ( std::string(name) == ACTIVATION_NAMES[a] ) return a;
+   return -1;
+}
+
+const char* ActivationName( int a )
+{
+   return ACTIVATION_NAMES[a];
+}
+
+void GemvInt8( const signed char* w, const short* in, int* out, int rows, int cols )
+{
+   kernel->gemv_int8( w, in, out, rows, cols );
+}
+
+void SumRows( const double* table, const int* rows, int count, double* out, int n )
+{
+   kernel->sum_rows( table, rows, count, out, n );
+}
+
+void HashVector( uint64_t key, uint64_t first, uint64_t* out, int n )
+{
+   kernel->hash( key, first, out, n );
+}
+
+void MutateVector( const double* sa, const double* g, double taup, double step, double* child_sa, double* delta, int n )
+{
+   kernel->mutate( sa, g, taup, step, child_sa, delta, n );
+}
+
+
+// SelectKernel()
+// Forces the kernels named 'name' ("scalar", "avx2" or "avx512").
+// Returns false if they are unknown or not supported by this CPU.
+bool SelectKernel( const char* name )
+{
+   std::string n(name);
+   if ( n == KERNEL_SCALAR.name ) { kernel = &KERNEL_SCALAR; return true; }
+#ifdef KERNEL_X86
+   __builtin_cpu_init();
+   if ( n == KERNEL_AVX2.name && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") )
+   { kernel = &KERNEL_AVX2; return true; }
+   if ( n == KERNEL_AVX512.name && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") )
+   { kernel = &KERNEL_AVX512; return true; }
+#endif
+   return false;
+}
+
+// KernelName()
+// Returns the name of the kernels in use.
+const char* KernelName()
+{
+   return kernel->name;
+}
@@ -0,0 +1,47 @@
+#ifndef ALNITE_KERNEL_H_
+#define ALNITE_KERNEL_H_
+
+// Inference and evolution kernels
+// The implementation is picked at startup from the features of the running CPU:
+// AVX-512, AVX2/FMA, or portable C++.
+
+// out[r] = sum of w[r*cols+c] * in[c], for each of the 'rows' rows of the row-major matrix 'w'
+void Gemv( const double* w, const double* in, double* out, int rows, int cols );
+
+// Hidden layer activations: sigmoid, or a faster approximation of it
+enum Activation
+{
+   ACTIVATION_EXACT,       // 1/(1+exp(-x))
+   ACTIVATION_TABLE,       // lookup table with linear interpolation
+   ACTIVATION_RATIONAL,    // (7,6) Pade approximation of tanh(x/2)
+   ACTIVATION_HARD         // clamp(x/4+1/2, 0, 1)
+};
+
+// v[i] = 1/(1+exp(-v[i]))
+void SigmoidVector( double* v, int n );
+
+// v[i] = activation 'a' of v[i]
+void ActivationVector( int a, double* v, int n );
+int ActivationByName( const char* name );
+const char* ActivationName( int a );
+
+// out[b*rows+r] = sum of w[r*cols+c] * in[b*cols+c], for each of 'count' inputs of 'cols' values
+void Gemm( const double* w, const double* in, double* out, int count, int rows, int cols );
+
+// out[i] += sum of table[rows[k]*n+i], for each of the 'count' rows listed in 'rows', in that order
+void SumRows( const double* table, const int* rows, int count, double* out, int n );
+
+// Integer version of Gemv(): int8 weights, int16 inputs, int32 sums
+void GemvInt8( const signed char* w, const short* in, int* out, int rows, int cols );
+
+// out[i] = RandomStream( key ).At( first+i ), the random bits of 'n' draws of a stream
+void HashVector( uint64_t key, uint64_t first, uint64_t* out, int n );
+
+// Self-adaptive mutation, see Population::Clone():
+// child_sa[i] = sa[i]*exp(taup*g[i]+step), delta[i] = child_sa[i]*g[i]
+void MutateVector( const double* sa, const double* g, double taup, double step, double* child_sa, double* delta, int n );
+
+bool SelectKernel( const char* name );
+const char* KernelName();
+
+#endif
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <algorithm>
 #include <iostream>
 #include <limits>
@@ -12,7 +13,9 @@
 #include <sstream>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <cmath>
 #include <ctime>
+#include <stdint.h>
 
 #endif
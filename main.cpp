@@ -4,6 +4,24 @@
 #include "nn.h"
 #include "handler.h"
 #include "population.h"
+#include "kernel.h"
+#include "qnn.h"
+#include "fixednn.h"
+#include "accumulator.h"
+#include "distil.h"
+#include "patterns.h"
+#include "td.h"
+#include "threadpool.h"
+#include "random.h"
+#include "checkpoint.h"
+#include "island.h"
+#include "match.h"
+#include "endgame.h"
+#include <chrono>
+#ifdef COUNT_ALLOCATIONS
+#include <atomic>
+#include <new>
+#endif
 
 // Constants
 const int PLAYER_HUMAN     = 1;
@@ -12,14 +30,63 @@ const int PLAYER_COMPUTER  = 2;
 const char* FILE_CURRENT_GEN  = "current.pop";
 const char* FILE_PREV_GEN     = "prev.pop";
 const char* FILE_NN_CONF      = "nn.conf";
+const char* FILE_DISTILLED    = "distilled.pop";
+const char* FILE_GAME_LOG     = "games.log";
+const char* FILE_PATTERNS     = "patterns.tbl";
+const char* FILE_TD           = "td.pop";
+const char* FILE_PROGRESS     = "progress.txt";
+const char* DIR_ISLANDS       = "islands";
 
+const char* CMD_SEED = "-s";
 const char* CMD_PLAY =  "-p";
 const char* CMD_TRAINNN = "-en";
 const char* CMD_TRAINRM = "-er";
+const char* CMD_TRAINSWISS = "-es";
+const char* CMD_TRAINRACING = "-ea";
+const char* CMD_BENCH = "-b";
+const char* CMD_DISTIL = "-d";
+const char* CMD_PATTERNS = "-tp";
+const char* CMD_TD = "-td";
+const char* CMD_BENCH_TOURNAMENT = "-bt";
+const char* CMD_BENCH_SWISS = "-bs";
+const char* CMD_BENCH_RACING = "-ba";
+const char* CMD_TO_BINARY = "-cb";
+const char* CMD_TO_TEXT = "-ct";
+const char* CMD_ISLANDS_NN = "-ein";
+const char* CMD_ISLANDS_RM = "-eir";
+const char* CMD_MATCH = "-m";
+
+const int DISTIL_EPOCHS       = 10;
+const double DISTIL_RATE      = 0.5;
+const int REPORT_MAX_DEPTH    = 4;
+const int REPORT_PAIRS        = 10;      // game pairs per match of the distillation report
+const int REPORT_OPENING      = 4;       // random moves at the start of each report game
+const int PATTERN_EPOCHS      = 20;
+const double PATTERN_RATE     = 0.002;
+const int TD_REPORT_GAMES     = 200;     // self-play games between two reports of the TD trainer
+const int BENCH_SEARCH_DEPTH  = 3;       // depth of the searches timed for each leaf evaluator
+const int BENCH_SOLVE_EMPTIES = 12;      // empties of the endgames solved with and without pattern ordering
+const int CHECKPOINT_PAIRINGS = 100;     // round robin pairings between two checkpoints within a generation
+const double RACING_Z         = 3.0;     // confidence of races, in standard errors
+const int MATCH_PAIRS         = 1000;    // most game pairs of a match
+const int MATCH_AB_DEPTH      = 3;       // search of the heuristic alpha-beta player, unless given
+const double MATCH_ELO1       = 20.0;    // Elo difference the SPRT of a match tells from none
+const double MATCH_ERROR      = 0.05;    // error rates of the SPRT of a match
 
 // Functions
 void Play( bool verbose, int black, int white, Population::Individual* cwp, Population::Individual* cbp );
 void DisplayOptions();
+void Benchmark( int num );
+void Distil( int games, const char* layers, int epochs );
+void TrainPatterns( int epochs );
+void TrainTD( int games, int threads );
+void Evolve( int gen, bool random_mover );
+void BenchmarkTournament( int gen );
+void BenchmarkSwiss( int rounds );
+void BenchmarkRacing( double z );
+bool Convert( const char* from, const char* to, bool binary );
+bool GetPlayer( const std::string& spec, Population& file_pop, MatchRunner::Player& player );
+void Match( const char* a, const char* b, double elo_error, int threads );
 
 
 // Global Variables
@@ -30,6 +97,38 @@ bool nn_from_file = true;
 
 Population curr_gen;
 
+#ifdef COUNT_ALLOCATIONS
+// Heap allocations so far, counted by operator new for the report of Benchmark(). Only
+// compiled in with -DCOUNT_ALLOCATIONS, as it costs every allocation of every thread.
+std::atomic<long> allocations( 0 );
+
+void* operator new( std::size_t size )
+{
+   allocations++;
+   void* p = malloc( size ? size : 1 );
+   if ( !p ) throw std::bad_alloc();
+   return p;
+}
+
+// the memory did come from malloc(), in operator new above
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete( void* p ) noexcept
+{
+   free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+   free( p );
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif
+
 
 // Play()
 // Plays a normal game
@@ -67,19 +166,790 @@ void Play( bool verbose, int white, int black, Population::Individual* cwp, Popu
 }
 
 
+// Benchmark()
+// Times 'num' evaluations by the first neural network of the current population,
+// on positions taken from random games, and counts the heap allocations of its searches
+// when built with COUNT_ALLOCATIONS.
+void Benchmark( int num )
+{
+   using namespace std;
+   curr_gen.Load( FILE_CURRENT_GEN );
+   NeuralNetwork& nn = curr_gen._population[0].nn;
+   NeuralNetwork::Context ctx;
+
+   // collect positions
+   vector<NeuralNetwork::nodes_type> inputs;
+   vector<Reversi::board_type> boards;
+   vector<Reversi::value_type> players;
+   for( int g=0; g<20; ++g )
+   {
+      Reversi::board_type board( 100, Reversi::EMPTY );
+      board[44] = board[55] = Reversi::WHITE;
+      board[45] = board[54] = Reversi::BLACK;
+      Reversi::value_type player = Reversi::BLACK;
+      Reversi::move_list moves;
+      int passes = 0;
+      while ( passes < 2 )
+      {
+         Reversi::value_type opp_pl = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+         if ( Reversi::MoveAvailable( board, player, moves ) )
+         {
+            vector<Reversi::index_type> movesv( moves.begin(), moves.end() );
+            Reversi::Perform( board, player, movesv[int(randf(0.0,double(movesv.size())))] );
+            inputs.push_back( NeuralNetwork::nodes_type() );
+            TranslateBoardtoNN( board, opp_pl, inputs.back() );
+            boards.push_back( board );
+            players.push_back( opp_pl );
+            passes = 0;
+         }
+         else passes++;
+         player = opp_pl;
+      }
+   }
+
+   double checksum = 0.0;
+   clock_t start = clock();
+   for( int i=0; i<num; ++i )
+   {
+      nn.Input( ctx, inputs[i%inputs.size()] );
+      nn.FeedForward( ctx );
+      checksum += nn.GetOutput( ctx );
+   }
+   double secs = double(clock()-start)/CLOCKS_PER_SEC;
+
+   cout << "NN Layer Configuration: " << curr_gen._population[0].nn.NodesCount() << " nodes, " <<
+      curr_gen._population[0].nn.WeightCount() << " weights\n";
+   cout << "Kernels: " << KernelName() << "\n";
+   cout << "FeedForward: " << num << " evaluations in " << secs << "s (" << num/secs << " per second)\n";
+   cout << "Checksum: " << checksum << endl;
+
+   // the same positions in batches
+   int in_count = nn.InputNodesCount(), batch = int(inputs.size());
+   vector<float> batch_in( batch*in_count ), batch_out( batch );
+   for( int b=0; b<batch; ++b )
+      for( int i=0; i<in_count; ++i )
+         batch_in[b*in_count+i] = float(inputs[b][i]);
+   double max_diff = 0.0;
+   nn.EvaluateBatch( &batch_in[0], batch, &batch_out[0] );
+   for( int b=0; b<batch; ++b )
+   {
+      nn.Input( ctx, inputs[b] );
+      nn.FeedForward( ctx );
+      max_diff = max( max_diff, fabs( batch_out[b] - nn.GetOutput( ctx ) ) );
+   }
+   start = clock();
+   for( int i=0; i<num; i+=batch )
+      nn.EvaluateBatch( &batch_in[0], min(batch, num-i), &batch_out[0] );
+   secs = double(clock()-start)/CLOCKS_PER_SEC;
+   cout << "EvaluateBatch: " << num << " evaluations in " << secs << "s (" << num/secs <<
+      " per second), max difference " << max_diff << "\n";
+
+   // leaf evaluation from first layer sums, as done in search: dynamic against fixed topology
+   vector<double> sums( inputs.size()*nn.GetLayerInfo()[1] );
+   for( unsigned int i=0; i<inputs.size(); ++i )
+      nn.FirstLayer( inputs[i], &sums[i*nn.GetLayerInfo()[1]] );
+   start = clock();
+   for( int i=0; i<num; ++i )
+   {
+      nn.FeedForwardFrom( ctx, &sums[(i%inputs.size())*nn.GetLayerInfo()[1]] );
+      checksum += nn.GetOutput( ctx );
+   }
+   secs = double(clock()-start)/CLOCKS_PER_SEC;
+   cout << "FeedForwardFrom: " << num/secs << " per second\n";
+
+   // first layer from the input vector, against the folded row/column bias and square table
+   start = clock();
+   for( int i=0; i<num; ++i )
+   {
+      TranslateBoardtoNN( boards[i%boards.size()], players[i%boards.size()], ctx.nodes );
+      nn.FirstLayer( ctx.nodes, &sums[(i%inputs.size())*nn.GetLayerInfo()[1]] );
+   }
+   secs = double(clock()-start)/CLOCKS_PER_SEC;
+   cout << "FirstLayer: " << num/secs << " per second\n";
+   Accumulator acc;
+   acc.SetNN( &nn );
+   double table_diff = 0.0;
+   for( unsigned int i=0; i<boards.size(); ++i )
+   {
+      acc.SetPlayer( players[i] );
+      acc.Refresh( 0, boards[i] );
+      for( int d=0; d<acc.Width(); ++d )
+         table_diff = max( table_diff, fabs( acc.Sums(0)[d] - sums[i*acc.Width()+d] ) );
+   }
+   start = clock();
+   for( int i=0; i<num; ++i )
+   {
+      acc.SetPlayer( players[i%boards.size()] );
+      acc.Refresh( 0, boards[i%boards.size()] );
+   }
+   secs = double(clock()-start)/CLOCKS_PER_SEC;
+   cout << "Square table first layer: " << num/secs << " per second, max difference " << table_diff << "\n";
+   FixedNetworkBase* fixed = CreateFixedNetwork( nn );
+   if ( fixed )
+   {
+      double max_diff = 0.0;
+      for( unsigned int i=0; i<inputs.size(); ++i )
+      {
+         nn.FeedForwardFrom( ctx, &sums[i*nn.GetLayerInfo()[1]] );
+         max_diff = max( max_diff, fabs( fixed->EvaluateFrom( &sums[i*nn.GetLayerInfo()[1]] ) - nn.GetOutput( ctx ) ) );
+      }
+      start = clock();
+      for( int i=0; i<num; ++i )
+         checksum += fixed->EvaluateFrom( &sums[(i%inputs.size())*nn.GetLayerInfo()[1]] );
+      secs = double(clock()-start)/CLOCKS_PER_SEC;
+      cout << "Fixed topology EvaluateFrom: " << num/secs << " per second, max difference " << max_diff << "\n";
+      delete fixed;
+   }
+   else
+      cout << "Fixed topology: not compiled in for this layer setup\n";
+
+   // fast activations: error of the function itself, and drift of the output
+   int activation = nn.GetActivation();
+   vector<double> exact( inputs.size() );
+   for( unsigned int i=0; i<inputs.size(); ++i )
+   {
+      nn.Input( ctx, inputs[i] );
+      nn.FeedForward( ctx );
+      exact[i] = nn.GetOutput( ctx );
+   }
+   vector<double> xs( 40001 ), ys( 40001 );
+   for( int i=0; i<=40000; ++i ) xs[i] = -20.0 + i*0.001;
+   for( int a=ACTIVATION_EXACT; a<=ACTIVATION_HARD; ++a )
+   {
+      ys = xs;
+      ActivationVector( a, &ys[0], int(ys.size()) );
+      double max_error = 0.0;
+      for( unsigned int i=0; i<xs.size(); ++i )
+         max_error = max( max_error, fabs( ys[i] - 1.0/(1.0+exp(-xs[i])) ) );
+
+      start = clock();
+      for( int r=0; r<100; ++r )
+      {
+         ys = xs;
+         ActivationVector( a, &ys[0], int(ys.size()) );
+      }
+      double values = 100.0*ys.size()/(double(clock()-start)/CLOCKS_PER_SEC);
+
+      nn.SetActivation( a );
+      double max_drift = 0.0;
+      for( unsigned int i=0; i<inputs.size(); ++i )
+      {
+         nn.Input( ctx, inputs[i] );
+         nn.FeedForward( ctx );
+         max_drift = max( max_drift, fabs( nn.GetOutput( ctx ) - exact[i] ) );
+      }
+
+      start = clock();
+      for( int i=0; i<num; ++i )
+      {
+         nn.Input( ctx, inputs[i%inputs.size()] );
+         nn.FeedForward( ctx );
+      }
+      secs = double(clock()-start)/CLOCKS_PER_SEC;
+      cout << "Activation " << ActivationName(a) << ": " << values << " values and " << num/secs <<
+         " evaluations per second, max error " << max_error << ", max output drift " << max_drift << "\n";
+   }
+
+   // quantised network, compared against the full network of the same activation on the
+   // same positions, then timed and searched with the network's own activation
+   QuantizedNetwork qnn;
+   QuantizedNetwork::Context qctx;
+   for( int a=ACTIVATION_EXACT; a<=ACTIVATION_HARD; ++a )
+   {
+      nn.SetActivation( a );
+      qnn.Build( nn );
+      double max_drift = 0.0, sum_drift = 0.0;
+      for( unsigned int i=0; i<inputs.size(); ++i )
+      {
+         nn.Input( ctx, inputs[i] );
+         nn.FeedForward( ctx );
+         double drift = fabs( qnn.Evaluate( qctx, inputs[i] ) - nn.GetOutput( ctx ) );
+         max_drift = max( max_drift, drift );
+         sum_drift += drift;
+      }
+      cout << "Quantised drift, " << ActivationName(a) << ": max " << max_drift << ", mean " << sum_drift/inputs.size() <<
+         " over " << inputs.size() << " positions\n";
+   }
+   nn.SetActivation( activation );
+   qnn.Build( nn );
+
+   checksum = 0.0;
+   start = clock();
+   for( int i=0; i<num; ++i )
+      checksum += qnn.Evaluate( qctx, inputs[i%inputs.size()] );
+   secs = double(clock()-start)/CLOCKS_PER_SEC;
+
+   cout << "Quantised, " << ActivationName(activation) << ": " << num << " evaluations in " << secs << "s (" <<
+      num/secs << " per second), " << qnn.MemorySize() << " bytes of weights" << endl;
+
+   // the same search with each leaf evaluator, and how often it picks the network's move
+   PatternTable patterns;
+   bool have_patterns = patterns.Load( FILE_PATTERNS );
+   const char* names[] = { "network", "quantised", "patterns" };
+   vector<Reversi::index_type> reference;
+   for( int e=0; e<3; ++e )
+   {
+      if ( e == 2 && !have_patterns ) continue;
+      NNComputer c( false );
+      if ( e == 0 ) c.SetNN( &curr_gen._population[0] );
+      if ( e == 1 ) c.SetQuantized( &qnn );
+      if ( e == 2 ) c.SetPatterns( &patterns );
+      c.SetDepth( BENCH_SEARCH_DEPTH );
+      int searches = 0, same = 0;
+      start = clock();
+      for( unsigned int i=0; i<boards.size(); ++i )
+      {
+         Reversi::move_list moves;
+         if ( !Reversi::MoveAvailable( boards[i], players[i], moves ) ) continue;
+         c.SetColor( players[i] );
+         Reversi::index_type move = c( boards[i], moves );
+         if ( e == 0 ) reference.push_back( move );
+         else if ( move == reference[searches] ) same++;
+         searches++;
+      }
+      secs = double(clock()-start)/CLOCKS_PER_SEC;
+      cout << "Depth " << BENCH_SEARCH_DEPTH << " search, " << names[e] << ": " << 1000.0*secs/max(searches,1) <<
+         " ms per search";
+      if ( e > 0 ) cout << ", same move as the network " << same << "/" << searches;
+      cout << endl;
+   }
+
+   // endgame solves in square order, then ordered by the pattern tables
+   if ( have_patterns )
+   {
+      double solve_secs[2];
+      vector<int> values[2];
+      for( int o=0; o<2; ++o )
+      {
+         EndgameAdjudicator solver;
+         if ( o == 1 ) solver.SetPatterns( &patterns );
+         start = clock();
+         for( unsigned int i=0; i<boards.size(); ++i )
+         {
+            int empties = 0, discs = 0;
+            for( Reversi::index_type s=11; s<89; ++s )
+               if ( boards[i][s] == Reversi::EMPTY && s%10 != 0 && s%10 != 9 ) empties++;
+            if ( empties == BENCH_SOLVE_EMPTIES ) values[o].push_back( solver.Solve( boards[i], players[i], discs ) );
+         }
+         solve_secs[o] = double(clock()-start)/CLOCKS_PER_SEC;
+      }
+      cout << "Endgame solves at " << BENCH_SOLVE_EMPTIES << " empties: " << 1000.0*solve_secs[0]/max(int(values[0].size()),1) <<
+         " ms in square order, " << 1000.0*solve_secs[1]/max(int(values[1].size()),1) << " ms ordered by patterns, " <<
+         ( values[0] == values[1] ? "same" : "DIFFERENT" ) << " results in " << values[0].size() << " positions" << endl;
+   }
+
+#ifdef COUNT_ALLOCATIONS
+   // searches must not allocate once warmed up, nor when the network is set for each game
+   // as by tournaments and matches
+   vector<Reversi::move_list> lists( boards.size() );
+   vector<int> searched;
+   for( unsigned int i=0; i<boards.size(); ++i )
+      if ( Reversi::MoveAvailable( boards[i], players[i], lists[i] ) ) searched.push_back( i );
+   NNComputer c( false );
+   c.SetNN( &curr_gen._population[0] );
+   c.SetDepth( BENCH_SEARCH_DEPTH );
+   long search_allocs = 0, game_allocs = 0;
+   for( int pass=0; pass<3; ++pass )
+   {
+      long before = allocations;
+      for( unsigned int k=0; k<searched.size(); ++k )
+      {
+         int i = searched[k];
+         if ( pass == 2 ) c.SetNN( &curr_gen._population[0] );
+         c.SetColor( players[i] );
+         c( boards[i], lists[i] );
+      }
+      if ( pass == 1 ) search_allocs = allocations - before;
+      if ( pass == 2 ) game_allocs = allocations - before;
+   }
+   cout << "Depth " << BENCH_SEARCH_DEPTH << " search, heap allocations: " << search_allocs << " in " <<
+      searched.size() << " searches, " << game_allocs << " with the network set before each" << endl;
+#endif
+}
+
+
+// Times the moves of 'handler'.
+class TimedHandler : public Reversi::PlayerHandler
+{
+   Reversi::PlayerHandler* _handler;
+   double                  _secs;
+   int                     _moves;
+
+public:
+   TimedHandler( Reversi::PlayerHandler* handler ) : _handler(handler), _secs(0.0), _moves(0)
+   {
+   }
+
+   Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves )
+   {
+      clock_t start = clock();
+      Reversi::index_type move = (*_handler)( board, moves );
+      _secs += double(clock()-start)/CLOCKS_PER_SEC;
+      _moves++;
+      return move;
+   }
+
+   double MillisPerMove() const
+   {
+      return ( _moves > 0 ) ? 1000.0*_secs/_moves : 0.0;
+   }
+};
+
+// PlayMatch()
+// Plays 'pairs' pairs of games with swapped colors between 'a' and 'b', each game starting
+// with a few random moves. Returns the score of 'a' (1 per win, 1/2 per draw) out of 2*pairs,
+// and the time per move of both.
+double PlayMatch( NNComputer& a, NNComputer& b, int pairs, double& a_ms, double& b_ms )
+{
+   Reversi game;
+   TimedHandler ta( &a ), tb( &b );
+   RandomOpening oa( &ta, REPORT_OPENING ), ob( &tb, REPORT_OPENING );
+   double score = 0.0;
+   int w, bl;
+   for( int p=0; p<pairs; ++p )
+   {
+      a.SetColor( Reversi::WHITE ); b.SetColor( Reversi::BLACK );
+      game.Start( oa, ob );
+      game.CountPieces( w, bl );
+      score += ( w > bl ) ? 1.0 : ( w == bl ) ? 0.5 : 0.0;
+
+      a.SetColor( Reversi::BLACK ); b.SetColor( Reversi::WHITE );
+      game.Start( ob, oa );
+      game.CountPieces( w, bl );
+      score += ( bl > w ) ? 1.0 : ( w == bl ) ? 0.5 : 0.0;
+   }
+   a_ms = ta.MillisPerMove();
+   b_ms = tb.MillisPerMove();
+   return score;
+}
+
+// Distil()
+// Distils the first network of the current population into a network of layer setup 'layers',
+// fitted over 'epochs' passes to the positions of 'games' self-play games, and saves it.
+// Then reports the strength of the student, alone and cascaded under the teacher, against
+// the teacher at each depth, and at equal time per move.
+void Distil( int games, const char* layers, int epochs )
+{
+   using namespace std;
+   curr_gen.Load( FILE_CURRENT_GEN );
+   Population::Individual& teacher = curr_gen._population[0];
+
+   Distiller distiller( &teacher );
+   distiller.Generate( games );
+   cout << "Samples: " << distiller.SampleCount() << "\n";
+   Population student_pop;
+   Population::Individual student;
+   student.nn.Create( layers );
+   double error = distiller.Fit( student.nn, epochs, DISTIL_RATE );
+   cout << "Student " << layers << ": " << student.nn.WeightCount() << " weights against " <<
+      teacher.nn.WeightCount() << ", held-out error " << error << "\n";
+   student_pop.Assign( layers, student.nn );
+   student_pop.Save( FILE_DISTILLED );
+
+   NNComputer t( false ), s( false ), c( false );
+   t.SetNN( &teacher );
+   s.SetNN( &student );
+   c.SetNN( &teacher );
+   c.SetLeafNN( &student.nn );
+   vector<double> t_ms( REPORT_MAX_DEPTH+1 ), s_ms( REPORT_MAX_DEPTH+1 );
+   cout << "Score out of " << 2*REPORT_PAIRS << " against the teacher at the same depth, ms per move:\n";
+   cout << "depth\tteacher\tstudent\tscore\tcascade\tscore\n";
+   for( int d=1; d<=REPORT_MAX_DEPTH; ++d )
+   {
+      double c_ms, dummy;
+      t.SetDepth( d ); s.SetDepth( d ); c.SetDepth( d );
+      double s_score = PlayMatch( s, t, REPORT_PAIRS, s_ms[d], t_ms[d] );
+      double c_score = PlayMatch( c, t, REPORT_PAIRS, c_ms, dummy );
+      cout << d << "\t" << t_ms[d] << "\t" << s_ms[d] << "\t" << s_score << "\t" << c_ms << "\t" << c_score << endl;
+   }
+
+   // the deepest teacher no slower than the student
+   cout << "At equal time per move:\n";
+   for( int d=1; d<=REPORT_MAX_DEPTH; ++d )
+   {
+      int td = 0;
+      for( int k=1; k<=REPORT_MAX_DEPTH; ++k )
+         if ( t_ms[k] <= s_ms[d] ) td = k;
+      if ( td == 0 || td == d ) continue;
+      double a_ms, b_ms;
+      s.SetDepth( d ); t.SetDepth( td );
+      double score = PlayMatch( s, t, REPORT_PAIRS, a_ms, b_ms );
+      cout << "student depth " << d << " (" << a_ms << " ms) against teacher depth " << td <<
+         " (" << b_ms << " ms): " << score << "/" << 2*REPORT_PAIRS << endl;
+   }
+}
+
+
+// TrainPatterns()
+// Fits pattern tables over 'epochs' passes to the games logged by training and saves them.
+// Then compares their speed and strength with the first network of the current population.
+void TrainPatterns( int epochs )
+{
+   using namespace std;
+   PatternTable patterns;
+   cout << "Patterns: " << patterns.PatternCount() << ", weights: " << patterns.WeightCount() << "\n";
+   int positions = patterns.Train( FILE_GAME_LOG, epochs, PATTERN_RATE );
+   if ( positions == 0 )
+   {
+      cout << "No games in " << FILE_GAME_LOG << ". Train with -en or -er first." << endl;
+      return;
+   }
+   cout << "Positions: " << positions << "\n";
+   patterns.Save( FILE_PATTERNS );
+
+   curr_gen.Load( FILE_CURRENT_GEN );
+   NNComputer nn( false ), pt( false );
+   nn.SetNN( &curr_gen._population[0] );
+   pt.SetPatterns( &patterns );
+   cout << "Score out of " << 2*REPORT_PAIRS << " of the pattern tables against the network, ms per move:\n";
+   cout << "depth\tnetwork\tpatterns\tscore\n";
+   for( int d=1; d<=REPORT_MAX_DEPTH; ++d )
+   {
+      double nn_ms, pt_ms;
+      nn.SetDepth( d ); pt.SetDepth( d );
+      double score = PlayMatch( pt, nn, REPORT_PAIRS, pt_ms, nn_ms );
+      cout << d << "\t" << nn_ms << "\t" << pt_ms << "\t" << score << endl;
+   }
+}
+
+
+// BenchmarkTournament()
+// Times 'gen' generations of EvolveNN on a copy of the current population with 1, 2, 4...
+// threads up to the hardware's, from the same seed, and checks that the results are the same.
+void BenchmarkTournament( int gen )
+{
+   using namespace std;
+   curr_gen.Load( FILE_CURRENT_GEN );
+   uint64_t seed = ThreadRandom().Next();
+   int hardware = HardwareThreads();
+   string reference;
+   double serial = 0.0;
+   cout << "threads\tseconds\tspeedup\tresults\n";
+   for( int t=1; ; t = min( 2*t, hardware ) )
+   {
+      Population pop = curr_gen;
+      pop.SetThreads( t );
+      stringstream out;
+      streambuf* old = cout.rdbuf( out.rdbuf() );
+      SetMasterSeed( seed );
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      pop.EvolveNN( gen );
+      double secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+      cout.rdbuf( old );
+
+      if ( t == 1 ) { reference = out.str(); serial = secs; }
+      cout << t << "\t" << secs << "\t" << serial/secs << "\t" <<
+         ( out.str() == reference ? "same" : "DIFFERENT" ) << endl;
+      if ( t == hardware ) break;
+   }
+}
+
+
+// BenchmarkSwiss()
+// Ranks the current population by a full round robin and by a Swiss tournament of 'rounds'
+// rounds, 0 for the default, and reports their cost and how well the rankings agree.
+void BenchmarkSwiss( int rounds )
+{
+   using namespace std;
+   curr_gen.Load( FILE_CURRENT_GEN );
+   Population full = curr_gen, swiss = curr_gen;
+   full.SetSwiss( 0 );
+   swiss.SetSwiss( rounds ? rounds : -1 );
+
+   stringstream out;
+   streambuf* old = cout.rdbuf( out.rdbuf() );
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   full.Rank();
+   double full_secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   start = chrono::steady_clock::now();
+   swiss.Rank();
+   double swiss_secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   cout.rdbuf( old );
+
+   // Spearman's rank correlation, and how many of the top half both keep
+   int n = full.GetSize(), full_games = 0, swiss_games = 0, top = 0;
+   double d2 = 0.0;
+   for( int i=0; i<n; ++i )
+   {
+      full_games += full._population[i].games_played;
+      swiss_games += swiss._population[i].games_played;
+      int j = 0;
+      while ( swiss._population[j].id != full._population[i].id ) ++j;
+      d2 += double(i-j)*(i-j);
+      if ( i < n/2 && j < n/2 ) top++;
+   }
+   cout << "Population: " << n << "\n";
+   cout << "Round robin: " << full_games/2 << " games in " << full_secs << "s\n";
+   cout << "Swiss: " << swiss_games/2 << " games in " << swiss_secs << "s\n";
+   cout << "Rank correlation: " << ( n > 1 ? 1.0 - 6.0*d2/(double(n)*(double(n)*n-1)) : 1.0 ) <<
+      ", top half in common: " << top << "/" << n/2 << endl;
+}
+
+
+// BenchmarkRacing()
+// Ranks the current population by a full round robin and by a race at a confidence of 'z'
+// standard errors, and reports their cost and how many of the top half both keep.
+void BenchmarkRacing( double z )
+{
+   using namespace std;
+   curr_gen.Load( FILE_CURRENT_GEN );
+   Population full = curr_gen, race = curr_gen;
+   race.SetRacing( z );
+
+   stringstream out;
+   streambuf* old = cout.rdbuf( out.rdbuf() );
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   full.Rank();
+   double full_secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   start = chrono::steady_clock::now();
+   race.Rank();
+   double race_secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   cout.rdbuf( old );
+
+   // the top half of the race, and where the round robin ranked the ones it disagrees on
+   int n = full.GetSize(), full_games = 0, race_games = 0, top = 0;
+   vector<int> wrong;
+   for( int i=0; i<n; ++i )
+   {
+      full_games += full._population[i].games_played;
+      race_games += race._population[i].games_played;
+      int j = 0;
+      while ( full._population[j].id != race._population[i].id ) ++j;
+      if ( i < n/2 && j < n/2 ) top++;
+      else if ( i < n/2 ) wrong.push_back( j );
+   }
+   cout << "Population: " << n << "\n";
+   cout << "Round robin: " << full_games/2 << " games in " << full_secs << "s\n";
+   cout << "Race: " << race_games/2 << " games in " << race_secs << "s\n";
+   cout << "Top half in common: " << top << "/" << n/2;
+   if ( !wrong.empty() )
+   {
+      cout << ", the others ranked";
+      for( unsigned int k=0; k<wrong.size(); ++k ) cout << " #" << wrong[k];
+      cout << " by the round robin, fitness " << full._population[n/2-1].fitness << " at #" << n/2-1;
+   }
+   cout << endl;
+}
+
+
+// Convert()
+// Converts the population file 'from', in either format, to 'to' in the binary format if
+// 'binary', else the text format, and reports the time taken.
+bool Convert( const char* from, const char* to, bool binary )
+{
+   using namespace std;
+   if ( !ifstream( from ).is_open() )
+   {
+      cout << "Error in opening file: " << from << endl;
+      return false;
+   }
+   Population pop;
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   if ( !pop.Load( from ) ) return false;
+   double load_secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   pop.SetBinary( binary );
+   start = chrono::steady_clock::now();
+   if ( !pop.Save( to ) )
+   {
+      cout << "Error in writing file: " << to << endl;
+      return false;
+   }
+   double save_secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   cout << "Loaded " << from << " in " << load_secs << "s, saved " << to << " (" <<
+      ( binary ? "binary" : "text" ) << ") in " << save_secs << "s" << endl;
+   return true;
+}
+
+
+// GetPlayer()
+// Sets 'player' as given by 'spec': 'rm' for the random mover, 'ab' for the heuristic
+// alpha-beta player, a number for that individual of the current population, or else a
+// population file for its first individual, a champion saved from another run, loaded into
+// 'file_pop'. A suffix ':D' sets the search depth. Returns false if there is no such player.
+bool GetPlayer( const std::string& spec, Population& file_pop, MatchRunner::Player& player )
+{
+   using namespace std;
+   string name = spec;
+   int depth = 0;
+   string::size_type colon = spec.rfind( ':' );
+   if ( colon != string::npos )
+   {
+      name = spec.substr( 0, colon );
+      depth = atoi( spec.substr( colon+1 ).c_str() );
+   }
+
+   if ( name == "rm" ) player = MatchRunner::RandomMover();
+   else if ( name == "ab" ) player = MatchRunner::Heuristic( depth > 0 ? depth : MATCH_AB_DEPTH );
+   else if ( name.find_first_not_of( "0123456789" ) == string::npos )
+   {
+      if ( curr_gen.GetSize() == 0 && !curr_gen.Load( FILE_CURRENT_GEN ) ) return false;
+      int i = atoi( name.c_str() );
+      if ( i >= curr_gen.GetSize() ) return false;
+      player = MatchRunner::Network( &curr_gen._population[i], depth > 0 ? depth : 1 );
+   }
+   else
+   {
+      if ( !file_pop.Load( name.c_str() ) || file_pop.GetSize() == 0 ) return false;
+      player = MatchRunner::Network( &file_pop._population[0], depth > 0 ? depth : 1 );
+   }
+   return true;
+}
+
+// Match()
+// Plays a match between players 'a' and 'b', see GetPlayer(), on 'threads' threads. It stops
+// once the Elo difference is known to within 'elo_error', or if that is 0 once an SPRT tells
+// whether 'a' is MATCH_ELO1 stronger or no stronger than 'b', and at most after MATCH_PAIRS pairs.
+void Match( const char* a, const char* b, double elo_error, int threads )
+{
+   using namespace std;
+   Population pop_a, pop_b;
+   MatchRunner::Player player_a, player_b;
+   if ( !GetPlayer( a, pop_a, player_a ) )
+   {
+      cout << "No player " << a << endl;
+      return;
+   }
+   if ( !GetPlayer( b, pop_b, player_b ) )
+   {
+      cout << "No player " << b << endl;
+      return;
+   }
+
+   MatchRunner runner;
+   runner.SetThreads( threads );
+   runner.SetPairs( MATCH_PAIRS );
+   runner.SetVerbose( true );
+   if ( elo_error > 0.0 ) runner.SetConfidence( elo_error );
+   else runner.SetSPRT( 0.0, MATCH_ELO1, MATCH_ERROR, MATCH_ERROR );
+   runner.Play( player_a, player_b );
+}
+
+
+// TrainTD()
+// Trains a network by TD(lambda) self-play for 'games' games on 'threads' threads, continuing
+// from td.pop, or from a new network of the layer setup of nn.conf if there is none.
+// Every few hundred games, saves it and reports the CPU time of training so far and its
+// score against the first network of the current population.
+void TrainTD( int games, int threads )
+{
+   using namespace std;
+   Population td_pop;
+   td_pop.Load( FILE_TD );
+   string layers = td_pop.GetLayers();
+   NeuralNetwork nn = td_pop._population[0].nn;
+   td_pop.Assign( layers.c_str(), nn );
+   Population::Individual& learner = td_pop._population[0];
+   curr_gen.Load( FILE_CURRENT_GEN );
+
+   TDTrainer trainer( &learner );
+   trainer.SetThreads( threads );
+   NNComputer a( false ), b( false );
+   a.SetNN( &learner );
+   b.SetNN( &curr_gen._population[0] );
+   double cpu = 0.0;
+   cout << "Score out of " << 2*REPORT_PAIRS << " against the first network of " << FILE_CURRENT_GEN << ":\n";
+   cout << "games\tpositions\tCPU hours\tscore\n";
+   for( int done=0; done<games; )
+   {
+      int block = min( TD_REPORT_GAMES, games-done );
+      clock_t start = clock();
+      int positions = trainer.Train( block );
+      cpu += double(clock()-start)/CLOCKS_PER_SEC;
+      done += block;
+      td_pop.Save( FILE_TD );
+
+      double a_ms, b_ms;
+      a.SetNN( &learner );
+      double score = PlayMatch( a, b, REPORT_PAIRS, a_ms, b_ms );
+      cout << done << "\t" << positions << "\t" << cpu/3600.0 << "\t" << score << endl;
+   }
+}
+
+
+// Evolve()
+// Evolves the current population for 'gen' generations, against itself or against the random
+// mover, continuing the generation it was checkpointed in. Checkpoints go to current.pop,
+// the one before to prev.pop, and the progress within the generation to progress.txt.
+void Evolve( int gen, bool random_mover )
+{
+   Checkpointer checkpoint( FILE_CURRENT_GEN, FILE_PREV_GEN, FILE_PROGRESS );
+   curr_gen.Load( FILE_CURRENT_GEN );
+   curr_gen.SetGameLog( FILE_GAME_LOG );
+   curr_gen.SetCheckpoint( &checkpoint, CHECKPOINT_PAIRINGS );
+   if ( curr_gen.Resume( FILE_PROGRESS ) )
+      std::cout << "Resuming generation " << curr_gen.GetGeneration() << " from " << FILE_PROGRESS << "\n";
+   if ( random_mover ) curr_gen.EvolveRM( gen );
+   else curr_gen.EvolveNN( gen );
+   curr_gen.SetCheckpoint( 0, 0 );
+   checkpoint.Flush();
+}
+
+
 // DisplayOptions()
 // Displays command-line options
 void DisplayOptions()
 {
    using namespace std;
-   cout << "Usage: rnn [options]\n";
+   cout << "Usage: rnn [-s S] [options]\n";
+   cout << "  -s S         Seeds all random numbers with S instead of the clock, to\n";
+   cout << "               reproduce a run. Comes before the other options.\n";
    cout << "Options:\n";
-   cout << "  -en X        Trains neural networks for X generations since the last train.\n";
-   cout << "               Evolved against neural networks.\n";
+   cout << "  -en X [A] [T] Trains neural networks for X generations since the last train.\n";
+   cout << "               Evolved against neural networks. A selects the hidden layer\n";
+   cout << "               activation: exact, table, rational or hard, default the one saved\n";
+   cout << "               with the population, which all other commands use too. The games\n";
+   cout << "               are played on T threads, default one per core.\n";
    cout << "               Example: -en 10 (train for 10 generations)\n";
-   cout << "  -er X        Trains neural networks for X generations since the last train.\n";
+   cout << "  -er X [A] [T] Trains neural networks for X generations since the last train.\n";
    cout << "               Against a random mover.\n";
-   cout << "               Example: -er 10 (train for 10 generations)\n";
+   cout << "               Example: -er 10 table (train for 10 generations, table activation)\n";
+   cout << "  -es X [R] [T] Same as -en, with Swiss tournaments of R rounds (default\n";
+   cout << "               2*log2 of the population size) instead of full round robins.\n";
+   cout << "               Training saves current.pop, and prev.pop the generation before,\n";
+   cout << "               after each generation, and progress.txt every 100 pairings of a\n";
+   cout << "               round robin. -en and -es continue an interrupted generation.\n";
+   cout << "  -ea X [Z] [T] Same as -en, with races instead of full round robins: pairs play\n";
+   cout << "               in rounds, and networks stop playing once they are in or out of\n";
+   cout << "               the top half with a confidence of Z (default 3) standard errors.\n";
+   cout << "  -ein I X [K] [M] Evolves I islands, each a process with a population of its\n";
+   cout << "               own in islands/islandI, for X generations as by -en. Every K\n";
+   cout << "               (default 5) generations each island sends copies of its M (default\n";
+   cout << "               2) best networks to the next one through islands/migrants. Islands\n";
+   cout << "               start from nn.conf, and are started again if they die.\n";
+   cout << "  -eir I X [K] [M] Same as -ein, against a random mover as by -er.\n";
+   cout << "  -b X [K]     Benchmarks X neural network evaluations, optionally using\n";
+   cout << "               kernels K (scalar, avx2 or avx512) instead of the best available,\n";
+   cout << "               then times the same search with each leaf evaluator, endgame solves\n";
+   cout << "               with and without the moves ordered by patterns.tbl if there is one,\n";
+   cout << "               and, if built with -DCOUNT_ALLOCATIONS, counts the heap allocations\n";
+   cout << "               of the search, which should be 0.\n";
+   cout << "  -bt X        Times X generations of -en on 1, 2, 4... threads up to one per\n";
+   cout << "               core and checks that they give the same results.\n";
+   cout << "  -bs [R]      Compares the ranking of the population by a Swiss tournament\n";
+   cout << "               of R rounds with a full round robin.\n";
+   cout << "  -ba [Z]      Compares the top half of the population by a race at a confidence\n";
+   cout << "               of Z standard errors with that of a full round robin.\n";
+   cout << "  -d G L [E]   Distils the first neural network into a smaller one with layer\n";
+   cout << "               setup L, fitted in E passes (default 10) over the positions of G\n";
+   cout << "               self-play games. Saves it to distilled.pop and reports its strength.\n";
+   cout << "               Example: -d 200 \"1152 16 1\"\n";
+   cout << "  -tp [E]      Fits pattern tables in E passes (default 20) to the games logged\n";
+   cout << "               to games.log by -en and -er, and saves them to patterns.tbl.\n";
+   cout << "  -td G [T]    Trains a network by TD(lambda) in G self-play games on T threads\n";
+   cout << "               (default one per core), continuing from td.pop or from nn.conf,\n";
+   cout << "               and saves it to td.pop.\n";
+   cout << "  -cb F T      Converts population file F to the binary format in file T.\n";
+   cout << "               Populations are loaded from either format, and saved in the one\n";
+   cout << "               they were loaded from.\n";
+   cout << "  -ct F T      Converts population file F to the text format in file T.\n";
+   cout << "  -m A B [E] [T] Plays game pairs between players A and B on T threads, each pair\n";
+   cout << "               from its own random opening, and reports the Elo difference.\n";
+   cout << "               A player is rm (random mover), ab (heuristic alpha-beta), the\n";
+   cout << "               number of a network of the current population, or a population\n";
+   cout << "               file for its first network, with :D for a search of D plies.\n";
+   cout << "               Stops once the Elo difference is within E (default: once an SPRT\n";
+   cout << "               tells whether A is 20 Elo stronger or not).\n";
+   cout << "               Example: -m 0 ab:2 (first network against alpha-beta, 2 plies)\n";
    cout << "  -p BW        Plays a single game. B and W specifies black and white players,\n";
    cout << "               respectively. Specify 'h' for human and 'c' for computer player.\n";
    cout << "               Example: -p ch (black is computer, white is human)\n\n";
@@ -95,8 +965,15 @@ int main( int argc, char** argv )
       return 0;
    }
 
-   // seed number
+   // seed number, from the clock unless given first
    reseed();
+   if ( argc > 3 && string(argv[1]) == CMD_SEED )
+   {
+      SetMasterSeed( strtoull( argv[2], 0, 10 ) );
+      argv[2] = argv[0];
+      argv += 2;
+      argc -= 2;
+   }
    
    // read commands
    int cmdi = 1;
@@ -162,9 +1039,18 @@ int main( int argc, char** argv )
       {
          string opt = string(argv[cmdi+1]);
          stringstream ss(opt); int gen; ss >> gen;
-         curr_gen.Load( FILE_CURRENT_GEN );
-         curr_gen.EvolveNN( gen );
-         curr_gen.Save( FILE_CURRENT_GEN );
+         if ( argc > 3 )
+         {
+            int a = ActivationByName( argv[cmdi+2] );
+            if ( a < 0 )
+            {
+               cout << "Invalid activation: " << argv[cmdi+2] << endl;
+               return 0;
+            }
+            curr_gen.SetActivation( a );
+         }
+         if ( argc > 4 ) curr_gen.SetThreads( atoi( argv[cmdi+3] ) );
+         Evolve( gen, false );
       }
    }
    else if ( cmdstr == CMD_TRAINRM )
@@ -177,9 +1063,152 @@ int main( int argc, char** argv )
       {
          string opt = string(argv[cmdi+1]);
          stringstream ss(opt); int gen; ss >> gen;
-         curr_gen.Load( FILE_CURRENT_GEN );
-         curr_gen.EvolveRM( gen );
-         curr_gen.Save( FILE_CURRENT_GEN );
+         if ( argc > 3 )
+         {
+            int a = ActivationByName( argv[cmdi+2] );
+            if ( a < 0 )
+            {
+               cout << "Invalid activation: " << argv[cmdi+2] << endl;
+               return 0;
+            }
+            curr_gen.SetActivation( a );
+         }
+         if ( argc > 4 ) curr_gen.SetThreads( atoi( argv[cmdi+3] ) );
+         Evolve( gen, true );
+      }
+   }
+   else if ( cmdstr == CMD_BENCH )
+   {
+      if ( argc < 3 )
+      {
+         cout << "Specify #evaluations to benchmark." << endl;
+      }
+      else
+      {
+         string opt = string(argv[cmdi+1]);
+         stringstream ss(opt); int num; ss >> num;
+         if ( argc > 3 && !SelectKernel( argv[cmdi+2] ) )
+         {
+            cout << "Kernels not available: " << argv[cmdi+2] << endl;
+            return 0;
+         }
+         Benchmark( num );
+      }
+   }
+   else if ( cmdstr == CMD_DISTIL )
+   {
+      if ( argc < 4 )
+      {
+         cout << "Specify #self-play games and the layer setup of the distilled network." << endl;
+      }
+      else
+      {
+         int games = atoi( argv[cmdi+1] );
+         int epochs = ( argc > 4 ) ? atoi( argv[cmdi+3] ) : DISTIL_EPOCHS;
+         Distil( games, argv[cmdi+2], epochs );
+      }
+   }
+   else if ( cmdstr == CMD_PATTERNS )
+   {
+      int epochs = ( argc > 2 ) ? atoi( argv[cmdi+1] ) : PATTERN_EPOCHS;
+      TrainPatterns( epochs );
+   }
+   else if ( cmdstr == CMD_TRAINSWISS )
+   {
+      if ( argc < 3 )
+      {
+         cout << "Specify #generations to train." << endl;
+      }
+      else
+      {
+         int gen = atoi( argv[cmdi+1] );
+         curr_gen.SetSwiss( ( argc > 3 ) ? atoi( argv[cmdi+2] ) : -1 );
+         if ( argc > 4 ) curr_gen.SetThreads( atoi( argv[cmdi+3] ) );
+         Evolve( gen, false );
+      }
+   }
+   else if ( cmdstr == CMD_ISLANDS_NN || cmdstr == CMD_ISLANDS_RM )
+   {
+      if ( argc < 4 )
+      {
+         cout << "Specify #islands and #generations to train." << endl;
+      }
+      else
+      {
+         Archipelago islands( DIR_ISLANDS, atoi( argv[cmdi+1] ) );
+         if ( argc > 4 ) islands.SetMigration( atoi( argv[cmdi+3] ), ( argc > 5 ) ? atoi( argv[cmdi+4] ) : 2 );
+         islands.SetEvolution( cmdstr == CMD_ISLANDS_RM, 0 );
+         islands.Run( atoi( argv[cmdi+2] ), FILE_NN_CONF );
+      }
+   }
+   else if ( cmdstr == CMD_TRAINRACING )
+   {
+      if ( argc < 3 )
+      {
+         cout << "Specify #generations to train." << endl;
+      }
+      else
+      {
+         int gen = atoi( argv[cmdi+1] );
+         curr_gen.SetRacing( ( argc > 3 ) ? atof( argv[cmdi+2] ) : RACING_Z );
+         if ( argc > 4 ) curr_gen.SetThreads( atoi( argv[cmdi+3] ) );
+         Evolve( gen, false );
+      }
+   }
+   else if ( cmdstr == CMD_BENCH_RACING )
+   {
+      BenchmarkRacing( ( argc > 2 ) ? atof( argv[cmdi+1] ) : RACING_Z );
+   }
+   else if ( cmdstr == CMD_BENCH_SWISS )
+   {
+      BenchmarkSwiss( ( argc > 2 ) ? atoi( argv[cmdi+1] ) : 0 );
+   }
+   else if ( cmdstr == CMD_TO_BINARY || cmdstr == CMD_TO_TEXT )
+   {
+      if ( argc < 4 )
+      {
+         cout << "Specify the population file to convert and the file to write." << endl;
+      }
+      else
+      {
+         Convert( argv[cmdi+1], argv[cmdi+2], cmdstr == CMD_TO_BINARY );
+      }
+   }
+   else if ( cmdstr == CMD_BENCH_TOURNAMENT )
+   {
+      if ( argc < 3 )
+      {
+         cout << "Specify #generations to benchmark." << endl;
+      }
+      else
+      {
+         BenchmarkTournament( atoi( argv[cmdi+1] ) );
+      }
+   }
+   else if ( cmdstr == CMD_MATCH )
+   {
+      if ( argc < 4 )
+      {
+         cout << "Specify the two players." << endl;
+      }
+      else
+      {
+         double elo_error = ( argc > 4 ) ? atof( argv[cmdi+3] ) : 0.0;
+         int threads = ( argc > 5 ) ? atoi( argv[cmdi+4] ) : 0;
+         Match( argv[cmdi+1], argv[cmdi+2], elo_error, threads );
+      }
+   }
+   else if ( cmdstr == CMD_TD )
+   {
+      if ( argc < 3 )
+      {
+         cout << "Specify #self-play games." << endl;
+      }
+      else
+      {
+         int games = atoi( argv[cmdi+1] );
+         int threads = ( argc > 3 ) ? atoi( argv[cmdi+2] ) : 0;
+         TrainTD( games, threads );
       }
    }
    else
@@ -0,0 +1,368 @@
+#include "lib.h"
+#include "match.h"
+#include "handler.h"
+#include "endgame.h"
+#include "threadpool.h"
+#include "random.h"
+#include <chrono>
+
+const int MATCH_BATCH_PAIRS     = 16;       // pairs played between two checks of the stopping rules
+const int MATCH_MAX_PAIRS       = 500;
+const int MATCH_OPENING         = 6;        // random moves at the start of each pair
+const int MATCH_SOLVE_EMPTIES   = 8;
+const double MATCH_MIN_VARIANCE = 0.01;     // of the score of a pair, so that a few equal pairs decide nothing
+const double MATCH_Z            = 1.96;     // of the 95% confidence interval
+
+
+// Plays the moves of an opening while the game is still in it, then leaves the moves to 'handler'.
+class OpeningHandler : public Reversi::PlayerHandler
+{
+   Reversi::PlayerHandler*                   _handler;
+   const std::vector<Reversi::index_type>*   _opening;
+
+public:
+   OpeningHandler() : _handler(0), _opening(0) {}
+
+   void Set( Reversi::PlayerHandler* handler, const std::vector<Reversi::index_type>* opening )
+   {
+      _handler = handler;
+      _opening = opening;
+   }
+
+   Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves )
+   {
+      // moves made so far, there are no passes in an opening
+      int played = -4;
+      for( int i=11; i<89; ++i )
+         if ( board[i] != Reversi::EMPTY ) played++;
+      if ( played < int(_opening->size()) && moves.count( (*_opening)[played] ) ) return (*_opening)[played];
+      return (*_handler)( board, moves );
+   }
+};
+
+
+// Plays the games of a batch of pairs on a thread pool, each thread at a table of its own.
+// Game 2*p+s is the 's'-th of pair 'p', in which the first player is white if 's' is 0.
+class MatchJob : public ThreadPool::Job
+{
+   struct Table
+   {
+      Reversi              game;
+      EndgameAdjudicator   adjudicator;
+      NNComputer           nn_a, nn_b;
+      RandomComputer       random_a, random_b;
+      OpeningHandler       opening[2];
+      NNComputer*          nn[2];         // of the first and second player
+      RandomComputer*      random[2];
+
+      Table() : nn_a(false), nn_b(false), random_a(false), random_b(false)
+      {
+         nn[0] = &nn_a; nn[1] = &nn_b;
+         random[0] = &random_a; random[1] = &random_b;
+      }
+   };
+
+   const MatchRunner::Player*                         _players[2];
+   const std::vector< std::vector<Reversi::index_type> >& _openings;     // of each pair
+   std::vector<RandomStream>&                         _streams;      // of the random movers, of each game
+   std::vector<double>&                               _scores;       // of the first player, of each game
+   std::vector<Table*>                                _tables;
+
+public:
+   MatchJob( const MatchRunner::Player& a, const MatchRunner::Player& b, const std::vector< std::vector<Reversi::index_type> >& openings,
+             std::vector<RandomStream>& streams, std::vector<double>& scores, int threads, int solve_empties, int margin_empties, int margin ) :
+   _openings(openings), _streams(streams), _scores(scores), _tables(threads)
+   {
+      _players[0] = &a;
+      _players[1] = &b;
+      for( int t=0; t<threads; ++t )
+      {
+         Table* table = new Table;
+         table->adjudicator.SetSolveEmpties( solve_empties );
+         table->adjudicator.SetMargin( margin_empties, margin );
+         table->game.SetAdjudicator( &table->adjudicator );
+         for( int p=0; p<2; ++p )
+         {
+            table->nn[p]->SetNN( _players[p]->ind );
+            table->nn[p]->SetHeuristic( _players[p]->kind == MatchRunner::HEURISTIC );
+            table->nn[p]->SetDepth( _players[p]->depth );
+         }
+         _tables[t] = table;
+      }
+   }
+
+   ~MatchJob()
+   {
+      for( unsigned int t=0; t<_tables.size(); ++t )
+         delete _tables[t];
+   }
+
+   void operator()( int task, int thread )
+   {
+      Table& t = *_tables[thread];
+      bool a_white = ( task % 2 == 0 );
+      for( int p=0; p<2; ++p )
+      {
+         Reversi::value_type color = ( a_white == ( p == 0 ) ) ? Reversi::WHITE : Reversi::BLACK;
+         Reversi::PlayerHandler* handler = t.nn[p];
+         if ( _players[p]->kind == MatchRunner::RANDOM_MOVER )
+         {
+            t.random[p]->SetStream( &_streams[2*task+p] );
+            t.random[p]->SetColor( color );
+            handler = t.random[p];
+         }
+         else
+            t.nn[p]->SetColor( color );
+         t.opening[p].Set( handler, &_openings[task/2] );
+      }
+
+      int w, b;
+      if ( a_white ) t.game.Start( t.opening[0], t.opening[1] );
+      else t.game.Start( t.opening[1], t.opening[0] );
+      t.game.CountPieces( w, b );
+      int apc = a_white ? w : b, bpc = a_white ? b : w;
+      _scores[task] = ( apc > bpc ) ? 1.0 : ( apc == bpc ) ? 0.5 : 0.0;
+   }
+};
+
+
+// EloDifference()
+// Returns the Elo difference of a player over another that it scores 'score' per game against.
+double EloDifference( double score )
+{
+   return -400.0 * log10( 1.0/score - 1.0 );
+}
+
+// expected score per game of a player 'elo' points stronger
+inline double expected_score( double elo )
+{
+   return 1.0 / ( 1.0 + pow( 10.0, -elo/400.0 ) );
+}
+
+
+MatchRunner::MatchRunner() :
+_threads(0), _max_pairs(MATCH_MAX_PAIRS), _opening(MATCH_OPENING),
+_solve_empties(MATCH_SOLVE_EMPTIES), _margin_empties(0), _margin(0),
+_elo0(0.0), _elo1(0.0), _alpha(0.05), _beta(0.05), _elo_error(0.0), _verbose(false)
+{
+}
+
+// Network()
+// Returns a player searching 'depth' plies with the network of individual 'ind'.
+MatchRunner::Player MatchRunner::Network( Population::Individual* ind, int depth )
+{
+   Player p;
+   p.kind = NETWORK;
+   p.ind = ind;
+   p.depth = depth;
+   return p;
+}
+
+// RandomMover()
+// Returns a player making random moves.
+MatchRunner::Player MatchRunner::RandomMover()
+{
+   Player p;
+   p.kind = RANDOM_MOVER;
+   p.ind = 0;
+   p.depth = 1;
+   return p;
+}
+
+// Heuristic()
+// Returns a player searching 'depth' plies with fixed square weights, see HeuristicEvaluator.
+MatchRunner::Player MatchRunner::Heuristic( int depth )
+{
+   Player p;
+   p.kind = HEURISTIC;
+   p.ind = 0;
+   p.depth = depth;
+   return p;
+}
+
+// _Update()
+// Fills in the statistics of 'r' from the score per game of each pair played, 'pair_scores'.
+// The pairs are the samples, as the two games of a pair share their opening.
+void MatchRunner::_Update( MatchRunner::Result& r, const std::vector<double>& pair_scores ) const
+{
+   int n = int(pair_scores.size());
+   double sum = 0.0, squares = 0.0;
+   for( int p=0; p<n; ++p )
+   {
+      sum += pair_scores[p];
+      squares += pair_scores[p]*pair_scores[p];
+   }
+   double mean = sum/n;
+   double var = std::max( squares/n - mean*mean, MATCH_MIN_VARIANCE );
+   double se = sqrt( var/n );
+
+   // away from 0 and 1, where the Elo difference is infinite
+   double lowest = 0.25/n;
+   double clamped = std::min( std::max( mean, lowest ), 1.0-lowest );
+   double low = std::min( std::max( mean - MATCH_Z*se, lowest ), 1.0-lowest );
+   double high = std::min( std::max( mean + MATCH_Z*se, lowest ), 1.0-lowest );
+   r.pairs = n;
+   r.score = mean;
+   r.elo = EloDifference( clamped );
+   r.elo_error = ( EloDifference( high ) - EloDifference( low ) )/2;
+
+   // generalised SPRT, with the scores taken as normally distributed
+   r.llr = 0.0;
+   r.sprt = 0;
+   if ( _elo0 != _elo1 )
+   {
+      double s0 = expected_score( _elo0 ), s1 = expected_score( _elo1 );
+      r.llr = n * (s1-s0) * (2*mean - s0 - s1) / (2*var);
+      if ( r.llr >= log( (1.0-_beta)/_alpha ) ) r.sprt = 1;
+      else if ( r.llr <= log( _beta/(1.0-_alpha) ) ) r.sprt = -1;
+   }
+}
+
+// Play()
+// Plays a match between 'a' and 'b', and reports and returns its result, for 'a'.
+MatchRunner::Result MatchRunner::Play( const MatchRunner::Player& a, const MatchRunner::Player& b )
+{
+   using namespace std;
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+   ThreadPool pool( _threads );
+   RandomStream match = ThreadRandom().Split();
+   Result r;
+   r.wins = r.draws = r.losses = 0;
+   vector<double> pair_scores;
+   vector< vector<Reversi::index_type> > openings;
+   vector<RandomStream> streams;
+   vector<double> scores;
+   Reversi::board_type board( 100 );
+   Reversi::index_type moves[Reversi::MAX_MOVES];
+
+   bool sprt = ( _elo0 != _elo1 );
+   if ( _verbose ) cout << "pairs\tscore\tElo\terror" << ( sprt ? "\tLLR\n" : "\n" );
+   while ( int(pair_scores.size()) < _max_pairs )
+   {
+      // the random openings and random movers of the batch
+      int first = int(pair_scores.size());
+      int count = min( MATCH_BATCH_PAIRS, _max_pairs-first );
+      openings.assign( count, vector<Reversi::index_type>() );
+      streams.resize( 4*count );
+      for( int p=0; p<count; ++p )
+      {
+         RandomStream random = match.Substream( first+p );
+         fill( board.begin(), board.end(), Reversi::EMPTY );
+         board[44] = board[55] = Reversi::WHITE;
+         board[45] = board[54] = Reversi::BLACK;
+         Reversi::value_type player = Reversi::BLACK;
+         for( int k=0; k<_opening; ++k )
+         {
+            int n = Reversi::GenerateMoves( board, player, moves );
+            if ( n == 0 ) break;
+            Reversi::index_type move = moves[random.Below( n )];
+            Reversi::Perform( board, player, move );
+            openings[p].push_back( move );
+            player = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+         }
+         for( int s=0; s<4; ++s )
+            streams[4*p+s] = random.Substream( s+1 );
+      }
+
+      scores.assign( 2*count, 0.0 );
+      MatchJob job( a, b, openings, streams, scores, pool.Threads(), _solve_empties, _margin_empties, _margin );
+      pool.Run( job, 2*count );
+      for( int p=0; p<count; ++p )
+      {
+         for( int s=0; s<2; ++s )
+         {
+            if ( scores[2*p+s] == 1.0 ) r.wins++;
+            else if ( scores[2*p+s] == 0.5 ) r.draws++;
+            else r.losses++;
+         }
+         pair_scores.push_back( ( scores[2*p] + scores[2*p+1] )/2 );
+      }
+
+      _Update( r, pair_scores );
+      if ( _verbose )
+      {
+         cout << r.pairs << "\t" << r.score << "\t" << r.elo << "\t" << r.elo_error;
+         if ( sprt ) cout << "\t" << r.llr;
+         cout << endl;
+      }
+      if ( r.sprt != 0 ) break;
+      if ( _elo_error > 0.0 && r.elo_error <= _elo_error ) break;
+   }
+   r.secs = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+   if ( pair_scores.empty() )
+   {
+      r.pairs = r.sprt = 0;
+      r.score = 0.5;
+      r.elo = r.elo_error = r.llr = 0.0;
+   }
+
+   cout << "Match: " << r.pairs << " pairs in " << r.secs << "s, " << r.wins << " wins, " << r.draws <<
+      " draws, " << r.losses << " losses\n";
+   cout << "Score: " << r.score << ", Elo " << ( r.elo >= 0.0 ? "+" : "" ) << r.elo << " +/- " << r.elo_error << "\n";
+   if ( sprt )
+   {
+      cout << "SPRT [" << _elo0 << ", " << _elo1 << "]: LLR " << r.llr << ", ";
+      if ( r.sprt > 0 ) cout << "H1 accepted\n";
+      else if ( r.sprt < 0 ) cout << "H0 accepted\n";
+      else cout << "no decision\n";
+   }
+   cout.flush();
+   return r;
+}
+
+// SetThreads()
+// Plays the games on 'threads' threads, 0 for one per hardware thread.
+void MatchRunner::SetThreads( int threads )
+{
+   _threads = threads;
+}
+
+// SetPairs()
+// Stops after 'pairs' pairs of games, if no other rule stopped the match before.
+void MatchRunner::SetPairs( int pairs )
+{
+   _max_pairs = pairs;
+}
+
+// SetOpening()
+// Starts both games of each pair with the same 'plies' random moves.
+void MatchRunner::SetOpening( int plies )
+{
+   _opening = plies;
+}
+
+// SetAdjudication()
+// Sets when games are stopped early, as Population::SetAdjudication().
+void MatchRunner::SetAdjudication( int solve_empties, int margin_empties, int margin )
+{
+   _solve_empties = solve_empties;
+   _margin_empties = margin_empties;
+   _margin = margin;
+}
+
+// SetSPRT()
+// Stops the match once a sequential probability ratio test decides between H0, that the
+// first player is 'elo0' Elo stronger, and H1, that it is 'elo1' Elo stronger, with error
+// rates 'alpha' and 'beta'. Equal 'elo0' and 'elo1' stop it.
+void MatchRunner::SetSPRT( double elo0, double elo1, double alpha, double beta )
+{
+   _elo0 = elo0;
+   _elo1 = elo1;
+   _alpha = alpha;
+   _beta = beta;
+}
+
+// SetConfidence()
+// Stops the match once the 95% confidence interval of the Elo difference is within
+// 'elo_error' either side. 0 stops it.
+void MatchRunner::SetConfidence( double elo_error )
+{
+   _elo_error = elo_error;
+}
+
+// SetVerbose()
+// Reports the result so far after each batch of pairs if 'verbose'.
+void MatchRunner::SetVerbose( bool verbose )
+{
+   _verbose = verbose;
+}
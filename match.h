@@ -0,0 +1,72 @@
+#ifndef ALNITE_MATCH_H_
+#define ALNITE_MATCH_H_
+
+#include "population.h"
+
+// Plays matches between two players to measure their difference in strength. Games come
+// in pairs: both start with the same few random moves, then the players swap colors. Pairs
+// are played in batches on a thread pool, and after each batch the match stops once a
+// sequential probability ratio test decides, see SetSPRT(), or the Elo difference is known
+// closely enough, see SetConfidence(). The openings and random moves are drawn from a stream
+// split off the caller's, so a match is reproduced by the seed whatever the thread count.
+class MatchRunner
+{
+public:
+   enum Kind { NETWORK, RANDOM_MOVER, HEURISTIC };
+
+   // One side of a match: an individual's network or the heuristic, searching 'depth'
+   // plies, or the random mover.
+   struct Player
+   {
+      Kind                    kind;
+      Population::Individual* ind;       // of a network player
+      int                     depth;
+   };
+
+   struct Result
+   {
+      int pairs;
+      int wins, draws, losses;            // of the first player
+      double score;                       // of the first player, per game
+      double elo;                         // of the first player over the second
+      double elo_error;                   // half of the 95% confidence interval of 'elo'
+      double llr;                         // log-likelihood ratio of the SPRT
+      int sprt;                           // 1 if it accepted H1, -1 if it accepted H0, else 0
+      double secs;
+   };
+
+private:
+   int      _threads;            // 0 for one per hardware thread
+   int      _max_pairs;
+   int      _opening;            // random moves at the start of each pair
+   int      _solve_empties;
+   int      _margin_empties;
+   int      _margin;
+   double   _elo0, _elo1;        // hypotheses of the SPRT, none if equal
+   double   _alpha, _beta;       // error rates of the SPRT
+   double   _elo_error;          // stops once the error of the Elo difference is below it, 0 for never
+   bool     _verbose;
+
+   void _Update( Result& r, const std::vector<double>& pair_scores ) const;
+
+public:
+   MatchRunner();
+
+   static Player Network( Population::Individual* ind, int depth );
+   static Player RandomMover();
+   static Player Heuristic( int depth );
+
+   void SetThreads( int threads );
+   void SetPairs( int pairs );
+   void SetOpening( int plies );
+   void SetAdjudication( int solve_empties, int margin_empties, int margin );
+   void SetSPRT( double elo0, double elo1, double alpha, double beta );
+   void SetConfidence( double elo_error );
+   void SetVerbose( bool verbose );
+
+   Result Play( const Player& a, const Player& b );
+};
+
+double EloDifference( double score );
+
+#endif
@@ -1,6 +1,15 @@
 #include "lib.h"
 #include "nn.h"
 #include "common.h"
+#include "kernel.h"
+#include <atomic>
+
+// Weights are stored layer by layer. Each layer is a row-major matrix with one row per
+// node in the next layer, so a node's input weights are contiguous. Weight 'w' of a layer
+// in link order (as in GetWeights() and the population files) connects
+// src = w/next to dest = w%next, and is stored at dest*prev + src.
+
+std::atomic<uint64_t>   next_version( 1 );    // of the next change to any network's weights
 
 inline double sigmoid( double f )
 {
@@ -14,15 +23,18 @@ inline double sigmoid_last( double f )
 
 NeuralNetwork::NeuralNetwork()
 {
-   _nodes.clear();
-   _weights.clear();
+   _matrix.clear();
    _layer_info.clear();
    _layer_count = 0;
    _nodes_count = 0;
    _weight_count = 0;
+   _activation = ACTIVATION_EXACT;
+   _version = next_version++;
 }
 
-void NeuralNetwork::Create( const char* info )
+// _Layout()
+// Parses the layer setup 'info', then sizes nodes and weights accordingly.
+void NeuralNetwork::_Layout( const char* info )
 {
    std::stringstream ss(info);
    int x; int t = 0;
@@ -44,123 +56,351 @@ void NeuralNetwork::Create( const char* info )
       _layer_count++;
    }
 
-   // create nodes
-   _nodes.resize( _nodes_count );
-   for( int i=0; i<_nodes_count; ++i )
-      _nodes[i] = 0.0f;
+   _matrix.resize( _weight_count );
+   _version = next_version++;
+}
 
-   // create weights
-   _weights.resize( _weight_count );
-   int pwc = 0; int pl = 0;   // pwc = previous layer weight count, pl = node count in the previous layer
-   int plx = 0;               // plx = previous layer node count including current layer 'l'
+void NeuralNetwork::Create( const char* info )
+{
+   _Layout( info );
+
+   // create weights, drawn in link order
+   int pwc = 0;                                    // pwc = previous layer weight count
    for( int l=0; l<_layer_count-1; ++l )           // for each layer 'l'
    {
-      int wtl = _layer_info[l] * _layer_info[l+1]; // wtl = weights at this layer
-      plx += _layer_info[l];
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      int wtl = prev * next;                       // wtl = weights at this layer
       for ( int w=0; w<wtl; ++w )
-      {
-         _weights[pwc+w].weight = randf(-0.5,0.5);
-         _weights[pwc+w].src = pl + w/_layer_info[l+1];
-         _weights[pwc+w].dest = plx + w%_layer_info[l+1];
-      }
+         _matrix[pwc + (w%next)*prev + w/next] = randf(-0.5,0.5);
       pwc += wtl;
-      pl += _layer_info[l];
    }
 }
 
 void NeuralNetwork::Create( const char* info, const NeuralNetwork::weight_type& wn )
 {
-   std::stringstream ss(info);
-   int x; int t = 0;
-   _layer_info.clear();
-   _layer_count = 0;
-   _nodes_count = 0;
-   _weight_count = 0;
-   // counts layer, nodes and weights
-   while( !ss.eof() )
-   {
-      ss >> x; _layer_info.push_back(x);
-      _nodes_count += x;
-      if ( t != 0 )
-      {
-         t *= x;
-         _weight_count += t;
-      }
-      t = x;
-      _layer_count++;
-   }
+   _Layout( info );
+   ReplaceWeight( wn );
+}
 
-   // create nodes
-   _nodes.resize( _nodes_count );
-   for( int i=0; i<_nodes_count; ++i )
-      _nodes[i] = 0.0f;
+// Create()
+// Lays out the network for 'info' with the weights 'matrix', in GetMatrix() order.
+void NeuralNetwork::Create( const char* info, const NeuralNetwork::value_type* matrix )
+{
+   _Layout( info );
+   std::copy( matrix, matrix+_weight_count, _matrix.begin() );
+}
 
-   // create weights
-   _weights.resize( _weight_count );
-   int pwc = 0; int pl = 0;   // pwc = previous layer weight count, pl = node count in the previous layer
-   int plx = 0;               // plx = previous layer node count including current layer 'l'
-   for( int l=0; l<_layer_count-1; ++l )           // for each layer 'l'
+void NeuralNetwork::ReplaceWeight( const NeuralNetwork::weight_type& wn )
+{
+   int pwc = 0;
+   for( int l=0; l<_layer_count-1; ++l )
    {
-      int wtl = _layer_info[l] * _layer_info[l+1]; // wtl = #weights at this layer
-      plx += _layer_info[l];
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      int wtl = prev * next;                       // wtl = #weights at this layer
       for ( int w=0; w<wtl; ++w )
-      {
-         _weights[pwc+w].weight = wn[pwc+w].weight;
-         _weights[pwc+w].src = pl + w/_layer_info[l+1];
-         _weights[pwc+w].dest = plx + w%_layer_info[l+1];
-      }
+         _matrix[pwc + (w%next)*prev + w/next] = wn[pwc+w].weight;
       pwc += wtl;
-      pl += _layer_info[l];
    }
+   _version = next_version++;
 }
 
-void NeuralNetwork::ReplaceWeight( const NeuralNetwork::weight_type& w )
+// SetActivation()
+// Selects the activation of the hidden layers, one of ACTIVATION_* in kernel.h.
+// The output node always uses sigmoid_last().
+void NeuralNetwork::SetActivation( int a )
 {
-   for( int i=0; i<_weight_count; ++i )
-      _weights[i].weight = w[i].weight;
+   _activation = a;
+   _version = next_version++;
+}
+
+int NeuralNetwork::GetActivation() const
+{
+   return _activation;
 }
 
-void NeuralNetwork::Input( NeuralNetwork::nodes_type& input )
+// Input()
+// Sets the inputs of 'ctx' to 'input', sizing 'ctx' for this network.
+void NeuralNetwork::Input( NeuralNetwork::Context& ctx, const NeuralNetwork::nodes_type& input ) const
 {
    // clear previous results
+   ctx.nodes.resize( _nodes_count );
    for( int i=0; i<_nodes_count; ++i )
-      _nodes[i] = 0.0f;
+      ctx.nodes[i] = 0.0f;
 
    if ( _layer_info.size() > 0 )
    {
       int val = ( _layer_info[0] < int(input.size()) ) ? _layer_info[0] : int(input.size());
-      for( int i=0; i<val; ++i ) _nodes[i] = input[i];
+      for( int i=0; i<val; ++i ) ctx.nodes[i] = input[i];
+   }
+}
+
+// FeedForward()
+// Matrix-vector product layer by layer. Hidden layers go through sigmoid(), the last node
+// through sigmoid_last(). Inputs are left as they are.
+void NeuralNetwork::FeedForward( NeuralNetwork::Context& ctx ) const
+{
+   value_type* in = &ctx.nodes[0];
+   value_type* out = in + _layer_info[0];
+   const value_type* w = &_matrix[0];
+   for( int l=0; l<_layer_count-1; ++l )
+   {
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      Gemv( w, in, out, next, prev );
+      if ( l+1 < _layer_count-1 )
+         ActivationVector( _activation, out, next );
+
+      w += prev*next;
+      in = out;
+      out += next;
    }
+
+   ctx.nodes[_nodes_count-1] = sigmoid_last(ctx.nodes[_nodes_count-1]);
 }
 
-void NeuralNetwork::FeedForward()
+// FirstLayer()
+// Computes the sums of the first layer after the inputs for 'input' into 'sums',
+// without touching the nodes.
+void NeuralNetwork::FirstLayer( const NeuralNetwork::nodes_type& input, NeuralNetwork::value_type* sums ) const
+{
+   Gemv( &_matrix[0], &input[0], sums, _layer_info[1], _layer_info[0] );
+}
+
+// FeedForwardFrom()
+// Same as FeedForward(), starting from the first layer sums 'sums' computed elsewhere,
+// e.g. by FirstLayer() or updated incrementally. The inputs of 'ctx' are not used.
+void NeuralNetwork::FeedForwardFrom( NeuralNetwork::Context& ctx, const NeuralNetwork::value_type* sums ) const
+{
+   ctx.nodes.resize( _nodes_count );
+   value_type* in = &ctx.nodes[_layer_info[0]];
+   for( int d=0; d<_layer_info[1]; ++d )
+      in[d] = sums[d];
+   if ( _layer_count == 2 )
+   {
+      ctx.nodes[_nodes_count-1] = sigmoid_last(ctx.nodes[_nodes_count-1]);
+      return;
+   }
+   ActivationVector( _activation, in, _layer_info[1] );
+
+   value_type* out = in + _layer_info[1];
+   const value_type* w = &_matrix[_layer_info[0]*_layer_info[1]];
+   for( int l=1; l<_layer_count-1; ++l )
+   {
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      Gemv( w, in, out, next, prev );
+      if ( l+1 < _layer_count-1 )
+         ActivationVector( _activation, out, next );
+
+      w += prev*next;
+      in = out;
+      out += next;
+   }
+
+   ctx.nodes[_nodes_count-1] = sigmoid_last(ctx.nodes[_nodes_count-1]);
+}
+
+// BatchScratchSize()
+// Returns the number of values of scratch needed to evaluate 'count' inputs at once.
+int NeuralNetwork::BatchScratchSize( int count ) const
+{
+   int widest = *std::max_element( _layer_info.begin(), _layer_info.end() );
+   return 2*count*widest;
+}
+
+// _BatchFrom()
+// Feeds 'count' activations of layer 'layer', stored in 'acts' one input after another, through the
+// rest of the network with one matrix product per layer. 'acts' is half of 'scratch' and the other
+// half receives the next layer. Leaves the output node of input 'b' at scratch[b].
+void NeuralNetwork::_BatchFrom( int layer, NeuralNetwork::value_type* acts, int count, NeuralNetwork::value_type* scratch ) const
+{
+   int half = BatchScratchSize( count )/2;
+   value_type* in = acts;
+   value_type* out = ( acts == scratch ) ? scratch+half : scratch;
+
+   int pwc = 0;
+   for( int l=0; l<layer; ++l ) pwc += _layer_info[l]*_layer_info[l+1];
+
+   int next = _layer_info[layer];
+   for( int l=layer; l<_layer_count-1; ++l )
+   {
+      int prev = _layer_info[l];
+      next = _layer_info[l+1];
+      Gemm( &_matrix[pwc], in, out, count, next, prev );
+      if ( l+1 < _layer_count-1 )
+         ActivationVector( _activation, out, count*next );
+
+      pwc += prev*next;
+      std::swap( in, out );
+   }
+
+   // in[] may alias scratch[], b*next >= b keeps the reads ahead of the writes
+   for( int b=0; b<count; ++b )
+      scratch[b] = sigmoid_last( in[b*next + next-1] );
+}
+
+// EvaluateBatch()
+// Evaluates 'count' inputs stored one after another in 'inputs', writing each output (as
+// GetOutput() would return it) to 'outputs'. Allocates its scratch on every call.
+void NeuralNetwork::EvaluateBatch( const float* inputs, int count, float* outputs ) const
+{
+   nodes_type scratch( BatchScratchSize(count) );
+   EvaluateBatch( inputs, count, outputs, &scratch[0] );
+}
+
+// EvaluateBatch()
+// Same, using 'scratch' of BatchScratchSize(count) values owned by the caller.
+void NeuralNetwork::EvaluateBatch( const float* inputs, int count, float* outputs, NeuralNetwork::value_type* scratch ) const
+{
+   for( int i=0; i<count*_layer_info[0]; ++i )
+      scratch[i] = inputs[i];
+   _BatchFrom( 0, scratch, count, scratch );
+   for( int b=0; b<count; ++b )
+      outputs[b] = float( scratch[b] );
+}
+
+// EvaluateBatchFrom()
+// Same, starting from 'count' first layer sums as made by FirstLayer() or an Accumulator,
+// with outputs at full precision for the search.
+void NeuralNetwork::EvaluateBatchFrom( const NeuralNetwork::value_type* sums, int count, NeuralNetwork::value_type* outputs, NeuralNetwork::value_type* scratch ) const
+{
+   int width = _layer_info[1];
+   for( int i=0; i<count*width; ++i )
+      scratch[i] = sums[i];
+   if ( _layer_count == 2 )
+   {
+      for( int b=0; b<count; ++b )
+         outputs[b] = sigmoid_last( scratch[b*width + width-1] );
+      return;
+   }
+   ActivationVector( _activation, scratch, count*width );
+   _BatchFrom( 1, scratch, count, scratch );
+   for( int b=0; b<count; ++b )
+      outputs[b] = scratch[b];
+}
+
+// Gradient()
+// Computes the derivative of the output with respect to every weight into 'grad', laid out
+// like GetMatrix(), for the evaluation last fed forward through 'ctx' from its inputs.
+// Hidden layers are differentiated as the sigmoid, which every activation approximates.
+void NeuralNetwork::Gradient( NeuralNetwork::Context& ctx, NeuralNetwork::nodes_type& grad ) const
+{
+   grad.resize( _weight_count );
+   ctx.deltas.assign( _nodes_count, 0.0 );
+   value_type out = ctx.nodes[_nodes_count-1];
+   ctx.deltas[_nodes_count-1] = out*(1.0-out)/8.0;
+
+   // walk the layers backwards, from the output
+   int next_off = _nodes_count - _layer_info[_layer_count-1];    // first node of layer l+1
+   int pwc = _weight_count;
+   for( int l=_layer_count-2; l>=0; --l )
+   {
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      int prev_off = next_off - prev;
+      pwc -= prev*next;
+      const value_type* w = &_matrix[pwc];
+      const value_type* a = &ctx.nodes[prev_off];
+      const value_type* dn = &ctx.deltas[next_off];
+      value_type* dp = &ctx.deltas[prev_off];
+      for( int d=0; d<next; ++d )
+      {
+         value_type* g = &grad[pwc + d*prev];
+         for( int s=0; s<prev; ++s )
+         {
+            g[s] = dn[d] * a[s];
+            dp[s] += dn[d] * w[d*prev+s];
+         }
+      }
+      if ( l > 0 )
+         for( int s=0; s<prev; ++s )
+            dp[s] *= a[s]*(1.0-a[s]);
+      next_off = prev_off;
+   }
+}
+
+// AdjustMatrix()
+// Adds 'step' times 'delta', laid out like GetMatrix(), to the weights.
+void NeuralNetwork::AdjustMatrix( const NeuralNetwork::nodes_type& delta, NeuralNetwork::value_type step )
 {
-   _link* t = 0; int li=0; int ls = _layer_info[li];
    for( int i=0; i<_weight_count; ++i )
+      _matrix[i] += step*delta[i];
+   _version = next_version++;
+}
+
+// Mutate()
+// Sets the weights to those of 'parent', of the same layer setup, plus 'delta' given in link
+// order, see GetWeights(). Writes each row of the matrix in turn.
+void NeuralNetwork::Mutate( const NeuralNetwork& parent, const NeuralNetwork::value_type* delta )
+{
+   int pwc = 0;
+   for( int l=0; l<_layer_count-1; ++l )
    {
-      t = &_weights[i];
-      // call sigmoid() when certain indices are reached
-      if ( t->src == ls )
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      const value_type* pm = &parent._matrix[pwc];
+      value_type* m = &_matrix[pwc];
+      const value_type* d = delta + pwc;
+      for( int r=0; r<next; ++r )
+         for( int c=0; c<prev; ++c )
+            m[r*prev+c] = pm[r*prev+c] + d[c*next+r];
+      pwc += prev*next;
+   }
+   _version = next_version++;
+}
+
+// GetWeights()
+// Returns all weights in link order, with their source and destination nodes.
+NeuralNetwork::weight_type NeuralNetwork::GetWeights() const
+{
+   weight_type wn( _weight_count );
+   int pwc = 0; int pl = 0;   // pwc = previous layer weight count, pl = node count in the previous layer
+   int plx = 0;               // plx = previous layer node count including current layer 'l'
+   for( int l=0; l<_layer_count-1; ++l )
+   {
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      int wtl = prev * next;
+      plx += prev;
+      for ( int w=0; w<wtl; ++w )
       {
-         ++li;
-         ls += _layer_info[li];
-         for( int j=t->src; j<ls; ++j )
-            _nodes[j] = sigmoid(_nodes[j]);
+         wn[pwc+w].weight = _matrix[pwc + (w%next)*prev + w/next];
+         wn[pwc+w].src = pl + w/next;
+         wn[pwc+w].dest = plx + w%next;
       }
-      _nodes[t->dest] += _nodes[t->src] * t->weight;
+      pwc += wtl;
+      pl += prev;
    }
+   return wn;
+}
 
-   _nodes[_nodes_count-1] = sigmoid_last(_nodes[_nodes_count-1]);
+// GetMatrix()
+// Returns all weights in storage order: one row-major (dest x src) matrix per layer.
+const NeuralNetwork::nodes_type& NeuralNetwork::GetMatrix() const
+{
+   return _matrix;
 }
 
-const NeuralNetwork::nodes_type& NeuralNetwork::GetNodes() const
+// Hash()
+// Returns a hash of the layer setup and the weights: equal for networks with the same
+// weights bit for bit, and almost certainly different otherwise.
+uint64_t NeuralNetwork::Hash() const
 {
-   return _nodes;
+   const uint64_t prime = 0x100000001b3ULL;
+   uint64_t h = 0xcbf29ce484222325ULL;
+   for( int l=0; l<_layer_count; ++l )
+      h = ( h ^ uint64_t(_layer_info[l]) ) * prime;
+   for( int i=0; i<_weight_count; ++i )
+   {
+      uint64_t bits;
+      memcpy( &bits, &_matrix[i], sizeof(bits) );
+      h = ( h ^ bits ) * prime;
+      h ^= h >> 29;
+   }
+   return h;
 }
 
-const NeuralNetwork::weight_type& NeuralNetwork::GetWeights() const
+// Version()
+// Returns a number that changes whenever the layer setup, weights or activation do, and that
+// copies share, so that tables derived from a network can be kept until it changes.
+uint64_t NeuralNetwork::Version() const
 {
-   return _weights;
+   return _version;
 }
 
 const NeuralNetwork::layer_info_type& NeuralNetwork::GetLayerInfo() const
@@ -168,9 +408,9 @@ const NeuralNetwork::layer_info_type& NeuralNetwork::GetLayerInfo() const
    return _layer_info;
 }
 
-NeuralNetwork::value_type NeuralNetwork::GetOutput() const
+NeuralNetwork::value_type NeuralNetwork::GetOutput( const NeuralNetwork::Context& ctx ) const
 {
-   return _nodes[_nodes_count-1];
+   return ctx.nodes[_nodes_count-1];
 }
 
 int NeuralNetwork::LayerCount() const
@@ -16,29 +16,57 @@ public:
 
    typedef std::vector<_link>       weight_type;
 
+   // Activations of one evaluation. The network itself is not changed by evaluating it,
+   // so threads can share a network as long as each one has its own Context.
+   struct Context
+   {
+      nodes_type     nodes;         // all nodes
+      nodes_type     deltas;        // scratch of Gradient()
+   };
+
 private:
-   nodes_type        _nodes;        // all nodes
-   weight_type       _weights;      // all weights
+   nodes_type        _matrix;       // all weights, one row-major (dest x src) matrix per layer
    layer_info_type   _layer_info;   // number of nodes in each layer(index)
 
    int               _layer_count;
    int               _nodes_count;
    int               _weight_count;
+   int               _activation;   // hidden layer activation, see kernel.h
+   uint64_t          _version;      // see Version()
+
+   void _Layout( const char* );
+   void _BatchFrom( int, value_type*, int, value_type* ) const;
 
 public:
    NeuralNetwork();
 
    void Create( const char* );
    void Create( const char*, const weight_type& );
+   void Create( const char*, const value_type* );
    void ReplaceWeight( const weight_type& );
-   void Input( nodes_type& );
-   void FeedForward();
+   void SetActivation( int );
+   int GetActivation() const;
+   void Input( Context&, const nodes_type& ) const;
+   void FeedForward( Context& ) const;
+   void FirstLayer( const nodes_type&, value_type* ) const;
+   void FeedForwardFrom( Context&, const value_type* ) const;
+
+   int BatchScratchSize( int ) const;
+   void EvaluateBatch( const float*, int, float* ) const;
+   void EvaluateBatch( const float*, int, float*, value_type* ) const;
+   void EvaluateBatchFrom( const value_type*, int, value_type*, value_type* ) const;
+
+   void Gradient( Context&, nodes_type& ) const;
+   void AdjustMatrix( const nodes_type&, value_type );
+   void Mutate( const NeuralNetwork&, const value_type* );
 
-   const nodes_type& GetNodes() const;
-   const weight_type& GetWeights() const;
+   weight_type GetWeights() const;
+   const nodes_type& GetMatrix() const;
    const layer_info_type& GetLayerInfo() const;
+   uint64_t Hash() const;
+   uint64_t Version() const;
 
-   value_type GetOutput() const;
+   value_type GetOutput( const Context& ) const;
    int LayerCount() const;
    int HiddenLayerCount() const;
    int InputNodesCount() const;
@@ -0,0 +1,230 @@
+#include "lib.h"
+#include "patterns.h"
+#include "common.h"
+
+const int HOLDOUT_PERCENT = 10;     // positions kept out of the fit to measure the error
+
+// Pattern types, one square list each in (row, column), 0 to 7.
+const int ROW1[]   = { 1,1,1,1,1,1,1,1 },  COLS_ALL[] = { 0,1,2,3,4,5,6,7 };
+const int ROW2[]   = { 2,2,2,2,2,2,2,2 };
+const int ROW3[]   = { 3,3,3,3,3,3,3,3 };
+const int DIAG[]   = { 0,1,2,3,4,5,6,7 };
+const int EDGE_R[] = { 0,0,0,0,0,0,0,0,1,1 }, EDGE_C[] = { 0,1,2,3,4,5,6,7,1,6 };
+const int C33_R[]  = { 0,0,0,1,1,1,2,2,2 },   C33_C[]  = { 0,1,2,0,1,2,0,1,2 };
+const int C25_R[]  = { 0,0,0,0,0,1,1,1,1,1 }, C25_C[]  = { 0,1,2,3,4,0,1,2,3,4 };
+
+inline int board_index( int row, int col )
+{
+   return (row+1)*10 + col+1;
+}
+
+
+// PatternTable()
+// Builds the patterns: rows and columns 2 to 4, diagonals of 4 to 8 squares, edges with
+// their X-squares, 3x3 and 2x5 corners. Weights start at zero.
+PatternTable::PatternTable() : _phase_size(0)
+{
+   _AddPattern( ROW1, COLS_ALL, 8 );
+   _AddPattern( ROW2, COLS_ALL, 8 );
+   _AddPattern( ROW3, COLS_ALL, 8 );
+   for( int len=8; len>=4; --len )
+      _AddPattern( DIAG, DIAG + 8-len, len );
+   _AddPattern( EDGE_R, EDGE_C, 10 );
+   _AddPattern( C33_R, C33_C, 9 );
+   _AddPattern( C25_R, C25_C, 10 );
+
+   _phase_size++;       // bias
+   _weights.assign( PHASES*_phase_size, 0.0f );
+}
+
+// _AddPattern()
+// Adds a pattern type of 'size' squares, and an instance for each distinct symmetry of it.
+void PatternTable::_AddPattern( const int* rows, const int* cols, int size )
+{
+   int type = int(_offsets.size());
+   _offsets.push_back( _phase_size );
+   int codes = 1;
+   for( int k=0; k<size; ++k ) codes *= 3;
+   _phase_size += codes;
+
+   std::vector< std::vector<int> > seen;
+   for( int t=0; t<8; ++t )
+   {
+      Pattern p;
+      p.type = type;
+      p.size = size;
+      for( int k=0; k<size; ++k )
+      {
+         int r = ( t & 1 ) ? 7-rows[k] : rows[k];
+         int c = ( t & 2 ) ? 7-cols[k] : cols[k];
+         if ( t & 4 ) std::swap( r, c );
+         p.squares[k] = board_index( r, c );
+      }
+
+      // the same squares in another order are the same pattern
+      std::vector<int> set( p.squares, p.squares+size );
+      std::sort( set.begin(), set.end() );
+      if ( std::find( seen.begin(), seen.end(), set ) != seen.end() ) continue;
+      seen.push_back( set );
+      _patterns.push_back( p );
+   }
+}
+
+// _Indexes()
+// Fills 'indexes' with the weight of each pattern of 'board' seen from 'player', followed by
+// the phase's bias. Returns how many there are.
+int PatternTable::_Indexes( const Reversi::board_type& board, Reversi::value_type player, int* indexes ) const
+{
+   int state[100], discs = 0;
+   for( int i=11; i<89; ++i )
+   {
+      if ( board[i] == Reversi::EMPTY ) state[i] = 0;
+      else { state[i] = ( board[i] == player ) ? 1 : 2; discs++; }
+   }
+   int base = std::min( PHASES-1, std::max( 0, discs-4 ) * PHASES / 61 ) * _phase_size;
+
+   int n = int(_patterns.size());
+   for( int p=0; p<n; ++p )
+   {
+      const Pattern& pt = _patterns[p];
+      int code = 0;
+      for( int k=0; k<pt.size; ++k )
+         code = code*3 + state[pt.squares[k]];
+      indexes[p] = base + _offsets[pt.type] + code;
+   }
+   indexes[n] = base + _phase_size-1;
+   return n+1;
+}
+
+// Evaluate()
+// Returns the expected final disc difference of 'board' for 'player'.
+double PatternTable::Evaluate( const Reversi::board_type& board, Reversi::value_type player ) const
+{
+   int indexes[64];
+   int n = _Indexes( board, player, indexes );
+   double sum = 0.0;
+   for( int i=0; i<n; ++i )
+      sum += _weights[indexes[i]];
+   return sum;
+}
+
+// Train()
+// Fits the weights by stochastic gradient descent on the squared error, 'epochs' passes with
+// step 'rate', to every position of the games logged in 'filename', from both sides.
+// The target is the final disc difference. Returns the number of positions, or 0 if there
+// are none.
+int PatternTable::Train( const char* filename, int epochs, double rate )
+{
+   std::ifstream file( filename );
+   if ( !file.is_open() ) return 0;
+
+   // replay the games into positions: the weight indexes of both sides, and the targets
+   int per = int(_patterns.size()) + 1;
+   std::vector<int> indexes;
+   std::vector<float> targets;
+   std::string line;
+   Reversi::board_type board( 100 );
+   Reversi::move_list moves;
+   while ( std::getline( file, line ) )
+   {
+      std::stringstream ss( line );
+      int w, b;
+      if ( !(ss >> w >> b) ) continue;
+      std::fill( board.begin(), board.end(), Reversi::EMPTY );
+      board[44] = board[55] = Reversi::WHITE;
+      board[45] = board[54] = Reversi::BLACK;
+      Reversi::value_type player = Reversi::BLACK;
+      Reversi::index_type move;
+      while ( ss >> move )
+      {
+         if ( !Reversi::MoveAvailable( board, player, moves ) )
+            player = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+         Reversi::Perform( board, player, move );
+         player = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+
+         indexes.resize( indexes.size() + 2*per );
+         _Indexes( board, Reversi::WHITE, &indexes[indexes.size() - 2*per] );
+         _Indexes( board, Reversi::BLACK, &indexes[indexes.size() - per] );
+         targets.push_back( float(w-b) );
+         targets.push_back( float(b-w) );
+      }
+   }
+   int count = int(targets.size());
+   if ( count == 0 ) return 0;
+
+   // positions come game by game, so the held out ones are from other games
+   int train = count - count*HOLDOUT_PERCENT/100;
+   std::vector<int> order( train );
+   for( int i=0; i<train; ++i ) order[i] = i;
+   for( int e=0; e<epochs; ++e )
+   {
+      for( int i=train-1; i>0; --i )
+         std::swap( order[i], order[int(randf(0.0,double(i+1)))] );
+
+      double sum = 0.0;
+      for( int k=0; k<train; ++k )
+      {
+         const int* idx = &indexes[order[k]*per];
+         double pred = 0.0;
+         for( int i=0; i<per; ++i ) pred += _weights[idx[i]];
+         double err = pred - targets[order[k]];
+         sum += err*err;
+         weight_type step = weight_type( rate*err );
+         for( int i=0; i<per; ++i ) _weights[idx[i]] -= step;
+      }
+
+      double held = 0.0;
+      for( int s=train; s<count; ++s )
+      {
+         double pred = 0.0;
+         for( int i=0; i<per; ++i ) pred += _weights[indexes[s*per+i]];
+         held += (pred - targets[s])*(pred - targets[s]);
+      }
+      std::cout << "Epoch " << e+1 << ": training error " << sqrt( sum/train ) << " discs, held-out error " <<
+         ( count > train ? sqrt( held/(count-train) ) : 0.0 ) << " discs" << std::endl;
+   }
+   return count;
+}
+
+// Load()
+// Loads the weights saved by Save() from file 'filename'.
+bool PatternTable::Load( const char* filename )
+{
+   std::ifstream file( filename );
+   if ( !file.is_open() ) return false;
+   int phases, size;
+   file >> phases >> size;
+   if ( phases != PHASES || size != _phase_size ) return false;
+
+   std::fill( _weights.begin(), _weights.end(), 0.0f );
+   int index;
+   weight_type weight;
+   while ( file >> index >> weight )
+      if ( index >= 0 && index < int(_weights.size()) ) _weights[index] = weight;
+   return true;
+}
+
+// Save()
+// Saves the weights to file 'filename'.
+// Format:
+// [PHASES] [WEIGHTS PER PHASE]
+// [INDEX] [WEIGHT], for each weight that is not zero
+bool PatternTable::Save( const char* filename ) const
+{
+   std::ofstream file( filename );
+   if ( !file.is_open() ) return false;
+   file << PHASES << " " << _phase_size << "\n";
+   for( unsigned int i=0; i<_weights.size(); ++i )
+      if ( _weights[i] != 0.0f ) file << i << " " << _weights[i] << "\n";
+   return true;
+}
+
+int PatternTable::PatternCount() const
+{
+   return int(_patterns.size());
+}
+
+int PatternTable::WeightCount() const
+{
+   return int(_weights.size());
+}
@@ -0,0 +1,47 @@
+#ifndef ALNITE_PATTERNS_H_
+#define ALNITE_PATTERNS_H_
+
+#include "reversi.h"
+
+// Logistello-style evaluation. The board is cut into edge, corner, row/column and diagonal
+// patterns, all eight symmetries of each. A pattern's squares read as a ternary code (empty,
+// player, opponent) index the weights of its pattern type for the current game phase, and
+// the value, an estimate of the final disc difference for the player, is their sum.
+// The weights are fitted by regression to the results of logged games (see Population::SetGameLog()).
+class PatternTable
+{
+public:
+   typedef float weight_type;
+
+   static const int PHASES = 10;          // game phases, by number of discs on the board
+   static const int MAX_SQUARES = 10;     // squares in the largest pattern
+
+private:
+   struct Pattern
+   {
+      int type;                        // shares weights with the other patterns of this type
+      int size;
+      int squares[MAX_SQUARES];        // board indices, most significant digit first
+   };
+
+   std::vector<Pattern>       _patterns;
+   std::vector<int>           _offsets;      // first weight of each pattern type within a phase
+   int                        _phase_size;   // weights per phase, the last one is the phase's bias
+   std::vector<weight_type>   _weights;      // _phase_size weights for each phase
+
+   void _AddPattern( const int* rows, const int* cols, int size );
+   int _Indexes( const Reversi::board_type& board, Reversi::value_type player, int* indexes ) const;
+
+public:
+   PatternTable();
+
+   double Evaluate( const Reversi::board_type& board, Reversi::value_type player ) const;
+   int Train( const char* filename, int epochs, double rate );
+   bool Load( const char* filename );
+   bool Save( const char* filename ) const;
+
+   int PatternCount() const;
+   int WeightCount() const;
+};
+
+#endif
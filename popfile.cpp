@@ -0,0 +1,184 @@
+#include "lib.h"
+#include "popfile.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const char     POPFILE_MAGIC[8] = { 'R','N','N','P','O','P','\0','\x1a' };
+const uint32_t POPFILE_VERSION  = 1;
+const uint64_t POPFILE_ALIGN    = 64;
+
+inline uint64_t align_up( uint64_t x )
+{
+   return ( x + POPFILE_ALIGN-1 ) / POPFILE_ALIGN * POPFILE_ALIGN;
+}
+
+
+// PopFileLayout()
+void PopFileLayout( PopFileHeader& h, uint32_t size, uint32_t layer_count, uint32_t weight_count )
+{
+   memset( &h, 0, sizeof(h) );
+   memcpy( h.magic, POPFILE_MAGIC, sizeof(h.magic) );
+   h.version = POPFILE_VERSION;
+   h.header_size = sizeof(PopFileHeader);
+   h.size = size;
+   h.layer_count = layer_count;
+   h.weight_count = weight_count;
+   h.topology_offset = align_up( sizeof(PopFileHeader) );
+   h.ids_offset = align_up( h.topology_offset + 4ULL*layer_count );
+   h.weights_offset = align_up( h.ids_offset + 4ULL*size );
+   h.sa_offset = align_up( h.weights_offset + 8ULL*size*weight_count );
+   h.file_size = h.sa_offset + 8ULL*size*weight_count;
+}
+
+// IsPopFile()
+// Returns true if 'filename' starts like a binary population file.
+bool IsPopFile( const char* filename )
+{
+   std::ifstream file( filename, std::ios::binary );
+   char magic[8];
+   return file.read( magic, sizeof(magic) ) && memcmp( magic, POPFILE_MAGIC, sizeof(magic) ) == 0;
+}
+
+// PopFileHostOrder()
+// Returns true if this machine is little-endian, so that files can be read and written as they are.
+bool PopFileHostOrder()
+{
+   uint32_t one = 1;
+   unsigned char first;
+   memcpy( &first, &one, 1 );
+   return first == 1;
+}
+
+
+MappedPopulation::MappedPopulation() : _data(0), _length(0), _mapped(false)
+{
+}
+
+MappedPopulation::~MappedPopulation()
+{
+   Close();
+}
+
+// Open()
+// Maps the binary population file 'filename'. Returns false if it cannot be read, is not
+// such a file, or is inconsistent: its blocks are not laid out as PopFileLayout() would, or
+// its weight count is not that of its topology.
+bool MappedPopulation::Open( const char* filename )
+{
+   Close();
+   if ( !PopFileHostOrder() ) return false;
+#ifndef _WIN32
+   int fd = open( filename, O_RDONLY );
+   if ( fd < 0 ) return false;
+   struct stat st;
+   if ( fstat( fd, &st ) == 0 && st.st_size >= (off_t)sizeof(PopFileHeader) )
+   {
+      void* p = mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if ( p != MAP_FAILED )
+      {
+         _data = (const unsigned char*)p;
+         _length = st.st_size;
+         _mapped = true;
+      }
+   }
+   close( fd );
+#else
+   std::ifstream file( filename, std::ios::binary );
+   file.seekg( 0, std::ios::end );
+   std::streamoff length = file.tellg();
+   if ( file && length >= (std::streamoff)sizeof(PopFileHeader) )
+   {
+      file.seekg( 0 );
+      _buffer.resize( (length+7)/8 );
+      if ( file.read( (char*)&_buffer[0], length ) )
+      {
+         _data = (const unsigned char*)&_buffer[0];
+         _length = length;
+      }
+   }
+#endif
+   if ( !_data ) return false;
+
+   // check that the blocks are where they should be, and fit
+   const PopFileHeader& h = Header();
+   PopFileHeader expected;
+   PopFileLayout( expected, h.size, h.layer_count, h.weight_count );
+   if ( memcmp( h.magic, POPFILE_MAGIC, sizeof(h.magic) ) != 0 || h.version != POPFILE_VERSION ||
+        h.header_size != sizeof(PopFileHeader) || uint64_t(h.size)*h.weight_count > _length/16 ||
+        h.topology_offset != expected.topology_offset ||
+        h.ids_offset != expected.ids_offset || h.weights_offset != expected.weights_offset ||
+        h.sa_offset != expected.sa_offset || h.file_size != expected.file_size || h.file_size > _length )
+   {
+      Close();
+      return false;
+   }
+
+   // check that the weights are those of the topology
+   const uint32_t* layers = Topology();
+   uint64_t wc = 0;
+   for( uint32_t l=0; l+1<h.layer_count; ++l )
+      wc += uint64_t(layers[l]) * layers[l+1];
+   bool empty_layer = false;
+   for( uint32_t l=0; l<h.layer_count; ++l )
+      if ( layers[l] == 0 ) empty_layer = true;
+   if ( h.layer_count < 2 || empty_layer || wc != h.weight_count )
+   {
+      Close();
+      return false;
+   }
+   return true;
+}
+
+void MappedPopulation::Close()
+{
+#ifndef _WIN32
+   if ( _mapped ) munmap( (void*)_data, _length );
+#endif
+   _buffer.clear();
+   _data = 0;
+   _length = 0;
+   _mapped = false;
+}
+
+const PopFileHeader& MappedPopulation::Header() const
+{
+   return *(const PopFileHeader*)_data;
+}
+
+const uint32_t* MappedPopulation::Topology() const
+{
+   return (const uint32_t*)( _data + Header().topology_offset );
+}
+
+// Layers()
+// Returns the layer setup, as in nn.conf.
+std::string MappedPopulation::Layers() const
+{
+   std::stringstream ss;
+   for( uint32_t l=0; l<Header().layer_count; ++l )
+      ss << ( l ? " " : "" ) << Topology()[l];
+   return ss.str();
+}
+
+int32_t MappedPopulation::Id( int i ) const
+{
+   return ((const int32_t*)( _data + Header().ids_offset ))[i];
+}
+
+// Weights()
+// Returns the weights of individual 'i', in NeuralNetwork::GetMatrix() order.
+const double* MappedPopulation::Weights( int i ) const
+{
+   return (const double*)( _data + Header().weights_offset ) + uint64_t(i)*Header().weight_count;
+}
+
+// SaParams()
+// Returns the self-adaptive parameters of individual 'i', in link order.
+const double* MappedPopulation::SaParams( int i ) const
+{
+   return (const double*)( _data + Header().sa_offset ) + uint64_t(i)*Header().weight_count;
+}
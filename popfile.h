@@ -0,0 +1,70 @@
+#ifndef ALNITE_POPFILE_H_
+#define ALNITE_POPFILE_H_
+
+#include <stdint.h>
+
+// Binary population files, the fast alternative to the text format of Population::Save().
+// Little-endian, and every block starts on a 64-byte boundary, so that the blocks can be read
+// from a mapped file as they are (MappedPopulation). Population::LoadBinary() still copies each
+// network out of it, in one block per network:
+//   header         PopFileHeader
+//   topology       uint32 nodes of each layer
+//   ids            int32 of each individual
+//   weights        float64, weight_count per individual, in NeuralNetwork::GetMatrix() order
+//   sa params      float64, weight_count per individual, in link order as Individual::sa_param
+struct PopFileHeader
+{
+   char     magic[8];            // POPFILE_MAGIC
+   uint32_t version;             // POPFILE_VERSION
+   uint32_t header_size;         // sizeof(PopFileHeader)
+   uint32_t size;                // individuals
+   uint32_t layer_count;
+   int32_t  generation;
+   int32_t  next_id;
+   uint32_t weight_count;        // per individual
+   uint32_t activation;          // ACTIVATION_* in kernel.h of all networks, 0 (exact) in older files
+   uint64_t topology_offset;     // of each block, from the start of the file
+   uint64_t ids_offset;
+   uint64_t weights_offset;
+   uint64_t sa_offset;
+   uint64_t file_size;
+};
+
+extern const char     POPFILE_MAGIC[8];
+extern const uint32_t POPFILE_VERSION;
+
+// The blocks of a population of 'size' networks of 'layer_count' layers and 'weight_count'
+// weights each, filling in the offsets and the file size of 'h'.
+void PopFileLayout( PopFileHeader& h, uint32_t size, uint32_t layer_count, uint32_t weight_count );
+bool IsPopFile( const char* filename );
+bool PopFileHostOrder();
+
+
+// A binary population file mapped into memory. Its blocks are checked against each other when
+// opened, and returned as pointers into the mapping.
+class MappedPopulation
+{
+   const unsigned char*       _data;
+   size_t                     _length;
+   bool                       _mapped;       // by mmap(), else read into _buffer
+   std::vector<uint64_t>      _buffer;       // 8-byte aligned
+
+   MappedPopulation( const MappedPopulation& );
+   MappedPopulation& operator=( const MappedPopulation& );
+
+public:
+   MappedPopulation();
+   ~MappedPopulation();
+
+   bool Open( const char* filename );
+   void Close();
+
+   const PopFileHeader& Header() const;
+   const uint32_t* Topology() const;
+   std::string Layers() const;
+   int32_t Id( int i ) const;
+   const double* Weights( int i ) const;
+   const double* SaParams( int i ) const;
+};
+
+#endif
@@ -2,13 +2,43 @@
 #include "population.h"
 #include "reversi.h"
 #include "handler.h"
+#include "endgame.h"
 #include "common.h"
+#include "kernel.h"
+#include "threadpool.h"
+#include "popfile.h"
+#include "checkpoint.h"
+#include "match.h"
+#include <chrono>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 const int FITNESS_WIN  =  1;
 const int FITNESS_LOSE = -2;
 const int FITNESS_DRAW =  0;
 const double DEG2RAD = 0.0174532925;
 
+const int ADJ_SOLVE_EMPTIES  = 8;
+const int ADJ_MARGIN_EMPTIES = 0;
+const int ADJ_MARGIN         = 0;
+
+const int    MEASURE_PAIRS     = 1000;   // most game pairs against the random mover after evolving
+const double MEASURE_ELO_ERROR = 25.0;   // measuring stops once the Elo difference is known to within this
+const int    MEASURE_AB_DEPTH  = 3;      // search of the heuristic alpha-beta mover
+
+const int    RACING_MIN_ROUNDS   = 4;     // rounds of a race before anyone may stop
+const double RACING_MIN_VARIANCE = 0.5;   // of the fitness per game, so that a few equal results decide nothing
+
+
+// copies the result of game 'from' to game 'to', the same game
+inline void CopyResult( const Population::Game& from, Population::Game& to )
+{
+   to.wpc = from.wpc;
+   to.bpc = from.bpc;
+   to.adjudicated = from.adjudicated;
+   to.moves = from.moves;
+}
 
 inline int to_int( std::string s )
 {
@@ -17,6 +47,15 @@ inline int to_int( std::string s )
    return x;
 }
 
+// Orders individuals, given by index, by fitness, highest first.
+struct ByFitness
+{
+   const std::vector<Population::Individual>& population;
+
+   ByFitness( const std::vector<Population::Individual>& p ) : population(p) {}
+   bool operator()( int a, int b ) const { return population[a].fitness > population[b].fitness; }
+};
+
 Population::Individual::Individual() :
 fitness(0), id(-1), pieces_won(0), pieces_played(0), games_won(0), games_played(0)
 {
@@ -43,6 +82,19 @@ bool Population::Individual::operator< ( const Population::Individual& rhs )
 }
 
 
+Population::Population() :
+_next_id(0), _size(0), _generation(0),
+_solve_empties(ADJ_SOLVE_EMPTIES), _margin_empties(ADJ_MARGIN_EMPTIES), _margin(ADJ_MARGIN),
+_activation(ACTIVATION_EXACT), _activation_set(false), _threads(0), _swiss_rounds(0), _racing_z(0.0), _binary(false),
+_checkpoint(0), _checkpoint_pairings(0), _resume_games(0), _measure_pairs(MEASURE_PAIRS), _reused(0)
+{
+   _last.generation = -1;
+   _last.best_id = -1;
+   _last.best_fitness = _last.best_games_won = _last.best_games_played = _last.games = 0;
+   _last.mean_fitness = 0.0;
+}
+
+
 // DisplayTop()
 // Displays the top 'n' neural networks.
 void Population::DisplayTop( int n )
@@ -62,44 +114,150 @@ void Population::DisplayTop( int n )
    cout.flush();
 }
 
+// Mutates the clones of Population::Clone() on a thread pool, one clone per task, straight into
+// the storage of the individuals they replace. Each thread has scratch of its own.
+class CloneJob : public ThreadPool::Job
+{
+   std::vector<Population::Individual>&   _population;
+   int                                    _parents;
+   int                                    _clones;       // per parent
+   int                                    _first_id;
+   double                                 _taup, _tau;
+   std::vector<Population::Individual::bias_type> _normals, _deltas;
+
+public:
+   CloneJob( std::vector<Population::Individual>& population, int parents, int clones, int first_id, int threads ) :
+   _population(population), _parents(parents), _clones(clones), _first_id(first_id), _normals(threads), _deltas(threads)
+   {
+      int wc = population[0].nn.WeightCount();
+      _taup = 1.0/sqrt(2.0*sqrt(double(wc))); // tau'
+      _tau = 1.0/sqrt(2.0*wc);
+      for( int t=0; t<threads; ++t )
+      {
+         _normals[t].resize( wc );
+         _deltas[t].resize( wc );
+      }
+   }
+
+   void operator()( int task, int thread )
+   {
+      int i = task / _clones;
+      const Population::Individual& parent = _population[i];
+      Population::Individual& child = _population[_parents + task];
+      int wc = parent.nn.WeightCount();
+      double* Nw = &_normals[thread][0];
+      double* delta = &_deltas[thread][0];
+
+      // adjust weight and bias based on the formula:
+      // sigma'(j) = sigma(j) * exp(taup*Nw(0,1)+tau*Ni(0,1))
+      // weight'(j) = weight(j) + sigma'(j)*Nw(0,1)
+      double Ni = TaskStream( _first_id + i*_clones ).Substream( 1 ).Gaussian();
+      RandomStream random = TaskStream( _first_id + task );
+      random.Gaussians( Nw, wc );
+      MutateVector( &parent.sa_param[0], Nw, _taup, _tau*Ni, &child.sa_param[0], delta, wc );
+      child.nn.Mutate( parent.nn, delta );
+      child.id = _first_id + task;
+   }
+};
+
+
 // Clone()
 // Clones the first 'n' individuals with slight random adjustments, removing the others.
-// Gaussian mutation.
-void Population::Clone( int n )
+// Gaussian mutation. Each clone is mutated from the task stream of its ID, and the clones of
+// an individual share a step from that of the first one, so a resumed run clones the same
+// and the clones may be made on the threads of 'pool' in any order.
+void Population::Clone( int n, ThreadPool& pool )
 {
-   std::cout << "Cloning neural networks..." << std::endl;
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   int num_clones = (_size/n)-1;
+   CloneJob job( _population, n, num_clones, _next_id, pool.Threads() );
+   pool.Run( job, n*num_clones );
+   _next_id += n*num_clones;
+   double ms = std::chrono::duration<double,std::milli>( std::chrono::steady_clock::now() - start ).count();
+   std::cout << "Cloned " << n*num_clones << " neural networks in " << ms << " ms" << std::endl;
 
-   int wc = _population[0].nn.WeightCount();
-   int cl = n; int num_clones = (_size/n)-1;
-   double taup = 1.0/sqrt(2.0*sqrt(double(wc))); // tau'
-   double tau = 1.0/sqrt(2.0*wc);
-   for( int i=0; i<n; ++i )   // Clone the first n
+   ResetFitness();
+}
+
+// Summarize()
+// Records the results of this generation once sorted. Its games had 'players' individuals each.
+void Population::Summarize( int players )
+{
+   _last.generation = _generation;
+   _last.best_id = _population[0].id;
+   _last.best_fitness = _population[0].fitness;
+   _last.best_games_won = _population[0].games_won;
+   _last.best_games_played = _population[0].games_played;
+   double sum = 0.0;
+   int played = 0;
+   for( int i=0; i<_size; ++i )
    {
-      double Ni = gaussrandf(0.0,1.0);
-      for (int c=0; c<num_clones; ++c )   // Make 'num_clones' clones for each n
-      {
-         NeuralNetwork::weight_type wwc = _population[i].nn.GetWeights();
-         Individual::bias_type tsa_param(wc);
+      sum += _population[i].fitness;
+      played += _population[i].games_played;
+   }
+   _last.mean_fitness = sum/_size;
+   _last.games = played/players;
+}
 
-         // adjust weight and bias based on the formula:
-         // sigma'(j) = sigma(j) * exp(taup*Nw(0,1)+tau*Ni(0,1))
-         // weight'(j) = weight(j) + sigma'(j)*Nw(0,1)
-         for( int w=0; w<wc; ++w )
-         {
-            double Nw = gaussrandf(0.0,1.0);
-            tsa_param[w] = _population[i].sa_param[w] * exp(taup*Nw+tau*Ni);
-            wwc[w].weight = wwc[w].weight + tsa_param[w]*Nw;
-         }
+// Match::operator<()
+bool Population::Match::operator< ( const Population::Match& rhs ) const
+{
+   if ( a != rhs.a ) return a < rhs.a;
+   if ( b != rhs.b ) return b < rhs.b;
+   if ( a_white != rhs.a_white ) return a_white < rhs.a_white;
+   return settings < rhs.settings;
+}
 
-         _population[cl].nn.ReplaceWeight( wwc );
-         _population[cl].sa_param = tsa_param;
-         _population[cl].id = _next_id;
-         ++_next_id;
-         ++cl;
-      }
+// Settings()
+// Returns a hash of the settings the games are played with: activation and adjudication.
+uint64_t Population::Settings() const
+{
+   const int settings[] = { _activation, _solve_empties, _margin_empties, _margin };
+   uint64_t h = 0xcbf29ce484222325ULL;
+   for( int k=0; k<4; ++k )
+      h = ( h ^ uint64_t(uint32_t(settings[k])) ) * 0x100000001b3ULL;
+   return h;
+}
+
+// GetMatch()
+// Returns the match of game 'g' between two individuals, during a tournament.
+Population::Match Population::GetMatch( const Population::Game& g ) const
+{
+   Match m;
+   m.a = _hashes[g.a];
+   m.b = _hashes[g.b];
+   m.a_white = g.a_white;
+   if ( m.a > m.b )
+   {
+      std::swap( m.a, m.b );
+      m.a_white = !m.a_white;
    }
+   m.settings = Settings();
+   return m;
+}
 
-   // reset fitness level
+// PruneMatches()
+// Removes the matches of networks no longer in the population, or played with other settings.
+void Population::PruneMatches()
+{
+   std::vector<uint64_t> hashes( _hashes );
+   std::sort( hashes.begin(), hashes.end() );
+   uint64_t settings = Settings();
+   std::map<Match, Game>::iterator i = _matches.begin();
+   while ( i != _matches.end() )
+   {
+      const Match& m = i->first;
+      if ( m.settings != settings || !std::binary_search( hashes.begin(), hashes.end(), m.a ) ||
+           !std::binary_search( hashes.begin(), hashes.end(), m.b ) )
+         _matches.erase( i++ );
+      else ++i;
+   }
+}
+
+// ResetFitness()
+// Resets the fitness level of all individuals.
+void Population::ResetFitness()
+{
    for( int i=0; i<_size; ++i )
    {
       _population[i].pieces_played = 0;
@@ -142,6 +300,7 @@ bool Population::Restart( const char* filename )
    {
       std::cout << "\rCreating new neural networks..." << i; std::cout.flush();
       _population[i].nn.Create( _nn_layers.c_str() );
+      _population[i].nn.SetActivation( _activation );
       _population[i].id = i;
 
       // initialize self-adaptive parameters
@@ -157,9 +316,11 @@ bool Population::Restart( const char* filename )
 }
 
 // Load()
-// Loads population from file 'filename'. Loads all if 'all' is true, otherwise just Coconut
+// Loads population from file 'filename', in either format. Loads all if 'all' is true, otherwise just Coconut
 bool Population::Load( const char* filename )
 {
+   if ( IsPopFile( filename ) ) return LoadBinary( filename );
+   _binary = false;
    std::ifstream file( filename );
    if ( file.is_open() )
    {
@@ -168,8 +329,12 @@ bool Population::Load( const char* filename )
       _size = to_int(line);
       _population.resize( _size );
       std::getline( file, _nn_layers );               // Read NN settings
-      std::getline( file, line );                     // Read generation
-      _generation = to_int(line);
+      std::getline( file, line );                     // Read generation, and activation if saved
+      std::stringstream gs(line);
+      int activation;
+      gs >> _generation;
+      if ( gs >> activation && !_activation_set && activation >= ACTIVATION_EXACT && activation <= ACTIVATION_HARD )
+         _activation = activation;
       int nc, wc;
       std::getline( file, line ); nc = to_int(line);  // Read node count
       std::getline( file, line ); wc = to_int(line);  // Read weight count
@@ -193,6 +358,7 @@ bool Population::Load( const char* filename )
             ss >> ccw[w].weight;
          }
          _population[nni].nn.Create( _nn_layers.c_str(), ccw );
+         _population[nni].nn.SetActivation( _activation );
          _population[nni].sa_param = tsa_param;
          nni++;
       }
@@ -207,12 +373,88 @@ bool Population::Load( const char* filename )
    return true;
 }
 
+// LoadBinary()
+// Loads population from the binary file 'filename', see popfile.h. Each network is copied
+// out of the mapped file in one block. The population is left as it was if the file is not
+// valid.
+bool Population::LoadBinary( const char* filename )
+{
+   MappedPopulation file;
+   if ( !file.Open( filename ) )
+   {
+      std::cout << "Error in reading file: " << filename << std::endl;
+      return false;
+   }
+   const PopFileHeader& h = file.Header();
+   std::string layers = file.Layers();
+   int activation = _activation;
+   if ( !_activation_set && h.activation <= uint32_t(ACTIVATION_HARD) ) activation = h.activation;
+   std::vector<Individual> population( h.size );
+   for( uint32_t i=0; i<h.size; ++i )
+   {
+      Individual& ind = population[i];
+      ind.id = file.Id( i );
+      ind.nn.Create( layers.c_str(), file.Weights( i ) );
+      ind.nn.SetActivation( activation );
+      ind.sa_param.assign( file.SaParams( i ), file.SaParams( i ) + h.weight_count );
+   }
+
+   _population.swap( population );
+   _size = h.size;
+   _nn_layers = layers;
+   _generation = h.generation;
+   _next_id = h.next_id;
+   _activation = activation;
+   _binary = true;
+   return true;
+}
+
+// SaveBinary()
+// Saves population to the binary file 'filename', see popfile.h.
+bool Population::SaveBinary( const char* filename )
+{
+   if ( !PopFileHostOrder() ) return false;
+   std::ofstream file( filename, std::ios::binary );
+   if ( !file.is_open() ) return false;
+
+   const NeuralNetwork::layer_info_type& layers = _population[0].nn.GetLayerInfo();
+   int wc = _population[0].nn.WeightCount();
+   PopFileHeader h;
+   PopFileLayout( h, _size, layers.size(), wc );
+   h.generation = _generation;
+   h.next_id = _next_id;
+   h.activation = _activation;
+   std::vector<char> zeros( 64, 0 );
+   file.write( (const char*)&h, sizeof(h) );
+
+   file.write( &zeros[0], h.topology_offset - file.tellp() );
+   for( unsigned int l=0; l<layers.size(); ++l )
+   {
+      uint32_t n = layers[l];
+      file.write( (const char*)&n, sizeof(n) );
+   }
+   file.write( &zeros[0], h.ids_offset - file.tellp() );
+   for( int i=0; i<_size; ++i )
+   {
+      int32_t id = _population[i].id;
+      file.write( (const char*)&id, sizeof(id) );
+   }
+   file.write( &zeros[0], h.weights_offset - file.tellp() );
+   for( int i=0; i<_size; ++i )
+      file.write( (const char*)&_population[i].nn.GetMatrix()[0], 8*wc );
+   file.write( &zeros[0], h.sa_offset - file.tellp() );
+   for( int i=0; i<_size; ++i )
+      file.write( (const char*)&_population[i].sa_param[0], 8*wc );
+   return bool(file);
+}
+
 // Save()
-// Saves population to file 'filename'.
-// Format:
+// Saves population to file 'filename', in the binary format if set by SetBinary() or loaded
+// from it, else as text.
+// Text format:
 // [POPULATION SIZE]
 // [NN LAYER SETUP]
-// [GENERATION #]
+// [GENERATION #] [ACTIVATION], see ACTIVATION_* in kernel.h, exact if left out
 // [#NODES IN EACH NN]
 // [#WEIGHTS IN EACH NN]
 // [ID FOR NEXT INDIVIDUAL]
@@ -222,13 +464,14 @@ bool Population::Load( const char* filename )
 // [ID_NN(n-1)] [WEIGHTS OF NN(n-1)]
 bool Population::Save( const char* filename )
 {
+   if ( _binary ) return SaveBinary( filename );
    std::ofstream file;
    file.open( filename );
    if ( file.is_open() )
    {
       file << _size << "\n";
       file << _nn_layers << "\n";
-      file << _generation << "\n";
+      file << _generation << " " << _activation << "\n";
       file << _population[0].nn.NodesCount() << "\n";
       file << _population[0].nn.WeightCount() << "\n";
       file << _next_id << "\n";
@@ -237,7 +480,6 @@ bool Population::Save( const char* filename )
       Individual::bias_type tsa_param(_population[0].nn.WeightCount());
       for( int i=0; i<_size; ++i )
       {
-         std::cout << "\rSaving neural networks..." << i; std::cout.flush();
          ccw = _population[i].nn.GetWeights();
          tsa_param = _population[i].sa_param;
          file << _population[i].id << " ";
@@ -250,7 +492,6 @@ bool Population::Save( const char* filename )
          }
          file << "\n";
       }
-      std::cout << "\n";
 
       file.close();
    }
@@ -261,120 +502,534 @@ bool Population::Save( const char* filename )
 }
 
 
+// Assign()
+// Replaces the population by the single network 'nn' with layer setup 'layers', e.g. to save
+// a network trained outside of evolution. Its self-adaptive parameters start as in Restart().
+void Population::Assign( const char* layers, const NeuralNetwork& nn )
+{
+   _nn_layers = layers;
+   _size = 1;
+   _generation = 0;
+   _next_id = 1;
+   _population.assign( 1, Individual() );
+   _population[0].nn = nn;
+   _population[0].id = 0;
+   _population[0].sa_param.resize( nn.WeightCount() );
+   for( int w=0; w<nn.WeightCount(); ++w )
+      _population[0].sa_param[w] = randf(-0.5,0.5);
+}
+
+
+// Plays the games of a tournament on a thread pool, each thread at a table of its own.
+class TournamentJob : public ThreadPool::Job
+{
+   struct Table
+   {
+      Reversi              game;
+      EndgameAdjudicator   adjudicator;
+      NNComputer           a, b;
+      RandomComputer       random;
+
+      Table() : a(false), b(false), random(false) {}
+   };
+
+   std::vector<Population::Individual>&   _population;
+   std::vector<Population::Game>&         _games;
+   const std::vector<int>&                _play;      // indices of the games to play
+   std::vector<Table*>                    _tables;
+
+public:
+   TournamentJob( std::vector<Population::Individual>& population, std::vector<Population::Game>& games, const std::vector<int>& play,
+                  int threads, int solve_empties, int margin_empties, int margin ) :
+   _population(population), _games(games), _play(play), _tables(threads)
+   {
+      for( int t=0; t<threads; ++t )
+      {
+         _tables[t] = new Table;
+         _tables[t]->adjudicator.SetSolveEmpties( solve_empties );
+         _tables[t]->adjudicator.SetMargin( margin_empties, margin );
+         _tables[t]->game.SetAdjudicator( &_tables[t]->adjudicator );
+      }
+   }
+
+   ~TournamentJob()
+   {
+      for( unsigned int t=0; t<_tables.size(); ++t )
+         delete _tables[t];
+   }
+
+   void operator()( int task, int thread )
+   {
+      Population::Game& g = _games[_play[task]];
+      Table& t = *_tables[thread];
+      Reversi::value_type a_color = g.a_white ? Reversi::WHITE : Reversi::BLACK;
+      Reversi::value_type b_color = g.a_white ? Reversi::BLACK : Reversi::WHITE;
+      Reversi::PlayerHandler* a = &t.a;
+      Reversi::PlayerHandler* b = &t.b;
+      t.a.SetNN( &_population[g.a] );
+      t.a.SetColor( a_color );
+      if ( g.b >= 0 )
+      {
+         t.b.SetNN( &_population[g.b] );
+         t.b.SetColor( b_color );
+      }
+      else
+      {
+         t.random.SetStream( &g.random );
+         t.random.SetColor( b_color );
+         b = &t.random;
+      }
+
+      int adjudicated = t.adjudicator.Count();
+      if ( g.a_white ) t.game.Start( *a, *b );
+      else t.game.Start( *b, *a );
+      t.game.CountPieces( g.wpc, g.bpc );
+      g.adjudicated = t.adjudicator.Count() > adjudicated;
+      g.moves = t.game.GetMoves();
+   }
+};
+
+
+// AddGame()
+// Adds a game of individual 'a', white if 'a_white', against individual 'b' or, if 'b' is -1,
+// the random mover to 'games'. The random mover gets a stream of its own, split off now so
+// that the games do not depend on the order they are played in.
+void Population::AddGame( std::vector<Population::Game>& games, int a, int b, bool a_white )
+{
+   Game g;
+   g.a = a;
+   g.b = b;
+   g.a_white = a_white;
+   if ( b < 0 ) g.random = ThreadRandom().Split();
+   g.wpc = g.bpc = 0;
+   g.adjudicated = false;
+   games.push_back( g );
+}
+
+// PlayGames()
+// Plays 'games' 'first' to 'last'-1, all if 'last' is -1, on the threads of 'pool'.
+// During a tournament, games between networks play the same every time, so those played
+// before are taken from _matches and the others are played once however often they occur.
+void Population::PlayGames( std::vector<Population::Game>& games, ThreadPool& pool, int first, int last )
+{
+   if ( last < 0 ) last = int(games.size());
+   std::vector<int> play, same( last-first, -1 );
+   std::map<Match, int> first_of;
+   for( int k=first; k<last; ++k )
+   {
+      Game& g = games[k];
+      if ( g.b < 0 || _hashes.empty() )
+      {
+         play.push_back( k );
+         continue;
+      }
+      Match m = GetMatch( g );
+      std::map<Match, Game>::const_iterator found = _matches.find( m );
+      std::map<Match, int>::const_iterator earlier = first_of.find( m );
+      if ( found != _matches.end() )
+      {
+         CopyResult( found->second, g );
+         _reused++;
+      }
+      else if ( earlier != first_of.end() ) same[k-first] = earlier->second;
+      else
+      {
+         first_of[m] = k;
+         play.push_back( k );
+      }
+   }
+
+   TournamentJob job( _population, games, play, pool.Threads(), _solve_empties, _margin_empties, _margin );
+   pool.Run( job, int(play.size()) );
+
+   for( std::map<Match, int>::const_iterator i=first_of.begin(); i!=first_of.end(); ++i )
+      _matches[i->first] = games[i->second];
+   for( int k=first; k<last; ++k )
+   {
+      if ( same[k-first] < 0 ) continue;
+      CopyResult( games[same[k-first]], games[k] );
+      _reused++;
+   }
+}
+
+// ReportGame()
+// Logs and displays game 'g', just played.
+// Returns 1 if the first player won, -1 if it lost, 0 for a draw.
+int Population::ReportGame( const Population::Game& g, std::ofstream& log )
+{
+   LogGame( log, g );
+   int apc = g.a_white ? g.wpc : g.bpc;
+   int bpc = g.a_white ? g.bpc : g.wpc;
+   std::cout << "[" << _generation << "] " << _population[g.a].id << ( g.a_white ? "[W]" : "[B]" ) << " vs. ";
+   if ( g.b >= 0 ) std::cout << _population[g.b].id;
+   else std::cout << "Random Mover";
+   std::cout << ( g.a_white ? "[B]" : "[W]" ) << ". ";
+
+   int result = ( apc > bpc ) ? 1 : ( apc < bpc ) ? -1 : 0;
+   if ( result == 0 ) std::cout << "Result: DRAW. ";
+   else if ( result > 0 ) std::cout << "Result: " << _population[g.a].id << " won. ";
+   else if ( g.b >= 0 ) std::cout << "Result: " << _population[g.b].id << " won. ";
+   else std::cout << "Result: Random Mover won. ";
+   std::cout << g.wpc << "-" << g.bpc << "\n";
+   return result;
+}
+
+// ScoreGame()
+// Adds game 'g', with 'result' for the first player as returned by ReportGame(), to the
+// fitness of the individuals that played it.
+void Population::ScoreGame( const Population::Game& g, int result )
+{
+   Individual& a = _population[g.a];
+   a.pieces_won += g.a_white ? g.wpc : g.bpc;
+   a.pieces_played += g.wpc+g.bpc;
+   a.games_played++;
+   if ( result > 0 ) { a.fitness += FITNESS_WIN; a.games_won++; }
+   else if ( result < 0 ) a.fitness += FITNESS_LOSE;
+   if ( g.b < 0 ) return;
+
+   Individual& b = _population[g.b];
+   b.pieces_won += g.a_white ? g.bpc : g.wpc;
+   b.pieces_played += g.wpc+g.bpc;
+   b.games_played++;
+   if ( result < 0 ) { b.fitness += FITNESS_WIN; b.games_won++; }
+   else if ( result > 0 ) b.fitness += FITNESS_LOSE;
+}
+
+
+// Tournament()
+// Plays a tournament of all individuals against each other, see SetSwiss(), adding to their fitness.
+// A round robin is checkpointed every few pairings, see SetCheckpoint(), and continues from
+// the games Resume() found played. Games played in earlier tournaments are reused, see PlayGames().
+void Population::Tournament( ThreadPool& pool, std::ofstream& log )
+{
+   _hashes.resize( _size );
+   for( int i=0; i<_size; ++i )
+      _hashes[i] = _population[i].nn.Hash();
+   PruneMatches();
+   _reused = 0;
+
+   if ( _swiss_rounds == 0 && _racing_z > 0.0 )
+   {
+      Race( pool, log );
+   }
+   else if ( _swiss_rounds == 0 )
+   {
+      // each pair plays twice, with swapped sides
+      std::vector<Game> games;
+      for( int i=0; i<_size-1; ++i )
+      {
+         for ( int j=i+1; j<_size; ++j )
+         {
+            AddGame( games, i, j, true );
+            AddGame( games, i, j, false );
+         }
+      }
+      int count = int(games.size());
+      int chunk = ( _checkpoint && _checkpoint_pairings > 0 ) ? 2*_checkpoint_pairings : count;
+      for( int first=std::min( _resume_games, count ); first<count; first+=chunk )
+      {
+         int last = std::min( first+chunk, count );
+         PlayGames( games, pool, first, last );
+         for( int k=first; k<last; ++k )
+            ScoreGame( games[k], ReportGame( games[k], log ) );
+         if ( _checkpoint && last < count )
+         {
+            log.flush();
+            _checkpoint->Save( 0, Progress( last ) );
+         }
+      }
+   }
+   else
+   {
+      if ( _resume_games > 0 ) ResetFitness();
+      // 2*log2(size), rounded up
+      int rounds = _swiss_rounds;
+      if ( rounds < 0 )
+      {
+         rounds = 0;
+         for( int n=1; n<_size; n*=2 ) rounds += 2;
+      }
+      Swiss( rounds, pool, log );
+   }
+
+   std::cout << "Reused " << _reused << " games played before\n";
+   _hashes.clear();
+}
+
+// Swiss()
+// Plays 'rounds' rounds of a Swiss tournament. Each round, the individuals are taken in order
+// of fitness so far and each is paired with the next one it has not met yet, for a single game
+// in which the one that has played white fewer times takes white. With an odd size, the lowest
+// individual that has not sat out yet sits the round out.
+void Population::Swiss( int rounds, ThreadPool& pool, std::ofstream& log )
+{
+   std::vector<int> order( _size ), whites( _size, 0 );
+   std::vector<bool> met( _size*_size, false ), sat_out( _size, false ), paired( _size );
+   std::vector<Game> games;
+   for( int r=0; r<rounds; ++r )
+   {
+      for( int i=0; i<_size; ++i ) order[i] = i;
+      std::stable_sort( order.begin(), order.end(), ByFitness( _population ) );
+      std::fill( paired.begin(), paired.end(), false );
+      if ( _size % 2 )
+      {
+         int k = _size-1;
+         while ( k > 0 && sat_out[order[k]] ) --k;
+         sat_out[order[k]] = paired[order[k]] = true;
+      }
+
+      games.clear();
+      for( int k=0; k<_size; ++k )
+      {
+         int a = order[k];
+         if ( paired[a] ) continue;
+         int b = -1;
+         for( int m=k+1; m<_size; ++m )
+         {
+            int c = order[m];
+            if ( paired[c] ) continue;
+            if ( b < 0 ) b = c;
+            if ( !met[a*_size+c] ) { b = c; break; }
+         }
+         if ( b < 0 ) break;
+         paired[a] = paired[b] = true;
+         met[a*_size+b] = met[b*_size+a] = true;
+         bool a_white = ( whites[a] < whites[b] ) || ( whites[a] == whites[b] && r%2 == 0 );
+         whites[a_white ? a : b]++;
+         AddGame( games, a, b, a_white );
+      }
+      PlayGames( games, pool );
+      for( unsigned int k=0; k<games.size(); ++k )
+         ScoreGame( games[k], ReportGame( games[k], log ) );
+   }
+}
+
+// FileSize()
+// Returns the size in bytes of file 'filename', 0 if there is none.
+static int64_t FileSize( const std::string& filename )
+{
+   std::ifstream file( filename.c_str(), std::ios::binary | std::ios::ate );
+   if ( !file.is_open() ) return 0;
+   return int64_t( file.tellg() );
+}
+
+// TruncateFile()
+// Cuts file 'filename' down to its first 'size' bytes.
+static bool TruncateFile( const std::string& filename, int64_t size )
+{
+#ifndef _WIN32
+   return truncate( filename.c_str(), off_t(size) ) == 0;
+#else
+   std::string data( size_t(size), '\0' );
+   std::ifstream in( filename.c_str(), std::ios::binary );
+   if ( !in.read( &data[0], size ) ) return false;
+   in.close();
+   std::ofstream out( filename.c_str(), std::ios::binary | std::ios::trunc );
+   return bool( out.write( data.data(), size ) );
+#endif
+}
+
+// Progress()
+// Returns the progress of the current generation after its first 'games' games, for Resume().
+// The game log must be flushed, as its size is saved too.
+// Format:
+// [GENERATION #] [GAMES PLAYED] [GAME LOG SIZE]
+// [ID] [WEIGHT HASH] [FITNESS] [GAMES WON] [GAMES PLAYED] [PIECES WON] [PIECES PLAYED], for each individual
+std::string Population::Progress( int games ) const
+{
+   std::stringstream ss;
+   ss << _generation << " " << games << " " << ( _game_log.empty() ? 0 : FileSize( _game_log ) ) << "\n";
+   for( int i=0; i<_size; ++i )
+   {
+      const Individual& ind = _population[i];
+      ss << ind.id << " " << ind.nn.Hash() << " " << ind.fitness << " " << ind.games_won << " " <<
+         ind.games_played << " " << ind.pieces_won << " " << ind.pieces_played << "\n";
+   }
+   return ss.str();
+}
+
+// Resume()
+// Restores the progress of the current generation saved by Progress() to file 'filename', if
+// it is of this generation and of these very individuals, in this order. The next round robin
+// then skips the games already played. The game log is cut back to its size then, dropping
+// the games played since, which are played and logged again. Returns true if games were restored.
+bool Population::Resume( const char* filename )
+{
+   _resume_games = 0;
+   std::ifstream file( filename );
+   if ( !file.is_open() ) return false;
+   int generation, games;
+   int64_t log_size;
+   std::string line;
+   std::getline( file, line );
+   std::stringstream ss( line );
+   if ( !(ss >> generation >> games) || generation != _generation || games < 0 ) return false;
+   if ( !(ss >> log_size) ) log_size = -1;        // saved before the log size was
+
+   std::vector<Individual> stats( _size );
+   for( int i=0; i<_size; ++i )
+   {
+      Individual& s = stats[i];
+      uint64_t hash;
+      if ( !(file >> s.id >> hash >> s.fitness >> s.games_won >> s.games_played >> s.pieces_won >> s.pieces_played) )
+         return false;
+      if ( s.id != _population[i].id || hash != _population[i].nn.Hash() ) return false;
+   }
+   if ( !_game_log.empty() && log_size >= 0 && FileSize( _game_log ) > log_size &&
+        !TruncateFile( _game_log, log_size ) )
+      std::cout << "Error in truncating file: " << _game_log << std::endl;
+   if ( games == 0 ) return false;
+
+   for( int i=0; i<_size; ++i )
+   {
+      Individual& ind = _population[i];
+      ind.fitness = stats[i].fitness;
+      ind.games_won = stats[i].games_won;
+      ind.games_played = stats[i].games_played;
+      ind.pieces_won = stats[i].pieces_won;
+      ind.pieces_played = stats[i].pieces_played;
+   }
+   _resume_games = games;
+   return true;
+}
+
+// Truncate()
+// Keeps the first 'size' individuals only.
+void Population::Truncate( int size )
+{
+   if ( size >= _size ) return;
+   _population.resize( size );
+   _size = size;
+}
+
+// Immigrate()
+// Replaces the last individuals by those of 'migrants', with new IDs. Returns false if their
+// networks are not of the same layer setup, or there are too many of them.
+bool Population::Immigrate( const Population& migrants )
+{
+   if ( migrants._nn_layers != _nn_layers || migrants._size >= _size ) return false;
+   for( int m=0; m<migrants._size; ++m )
+   {
+      Individual& ind = _population[_size-1-m];
+      ind = migrants._population[m];
+      ind.nn.SetActivation( _activation );
+      ind.id = _next_id++;
+   }
+   return true;
+}
+
+// Race()
+// Plays a round robin as a race for the top half. The pairs meet in rounds, by the circle
+// method, for two games with swapped sides. After each round, an individual stops once the
+// confidence interval of its fitness per game, _racing_z standard errors either side of the
+// mean, lies wholly above or below the line between the halves. A pair only plays while both
+// are in the race. Fitness is then projected to a full round robin: fitness per game times its games.
+void Population::Race( ThreadPool& pool, std::ofstream& log )
+{
+   if ( _resume_games > 0 ) ResetFitness();
+   int half = _size/2;
+   int slots = _size + _size%2;           // with an odd size, the last slot sits out
+   std::vector<int> slot( slots );
+   for( int s=0; s<slots; ++s ) slot[s] = s;
+   std::vector<double> squares( _size, 0.0 ), means( _size ), low( _size ), high( _size );
+   std::vector<bool> racing( _size, true );
+   std::vector<Game> games;
+   for( int r=0; r<slots-1; ++r )
+   {
+      games.clear();
+      for( int p=0; p<slots/2; ++p )
+      {
+         int a = std::min( slot[p], slot[slots-1-p] ), b = std::max( slot[p], slot[slots-1-p] );
+         if ( b >= _size || !racing[a] || !racing[b] ) continue;
+         AddGame( games, a, b, true );
+         AddGame( games, a, b, false );
+      }
+      PlayGames( games, pool );
+      for( unsigned int k=0; k<games.size(); ++k )
+      {
+         int result = ReportGame( games[k], log );
+         ScoreGame( games[k], result );
+         int fa = ( result > 0 ) ? FITNESS_WIN : ( result < 0 ) ? FITNESS_LOSE : FITNESS_DRAW;
+         int fb = ( result < 0 ) ? FITNESS_WIN : ( result > 0 ) ? FITNESS_LOSE : FITNESS_DRAW;
+         squares[games[k].a] += fa*fa;
+         squares[games[k].b] += fb*fb;
+      }
+      std::rotate( slot.begin()+1, slot.end()-1, slot.end() );
+      if ( r+1 < RACING_MIN_ROUNDS ) continue;
+
+      // the line between the halves is halfway between the means on either side of it
+      for( int i=0; i<_size; ++i )
+      {
+         int n = std::max( _population[i].games_played, 1 );
+         means[i] = double(_population[i].fitness)/n;
+         double var = std::max( squares[i]/n - means[i]*means[i], RACING_MIN_VARIANCE );
+         low[i] = means[i] - _racing_z*sqrt( var/n );
+         high[i] = means[i] + _racing_z*sqrt( var/n );
+      }
+      std::vector<double> sorted( means );
+      std::sort( sorted.begin(), sorted.end() );
+      double line = ( sorted[_size-half-1] + sorted[_size-half] )/2;
+      for( int i=0; i<_size; ++i )
+         if ( low[i] > line || high[i] < line ) racing[i] = false;
+   }
+
+   for( int i=0; i<_size; ++i )
+   {
+      Individual& ind = _population[i];
+      if ( ind.games_played > 0 ) ind.fitness = int( floor( double(ind.fitness)/ind.games_played * 2*(_size-1) + 0.5 ) );
+   }
+}
+
+// Rank()
+// Plays a tournament, see SetSwiss(), and sorts the individuals by fitness, without evolving them.
+void Population::Rank()
+{
+   ThreadPool pool( _threads );
+   std::ofstream log;
+   if ( !_game_log.empty() ) log.open( _game_log.c_str(), std::ios::app );
+   Tournament( pool, log );
+   std::sort( _population.begin(), _population.end() );
+}
+
+
 // EvolveNN()
 // Evolves population for 'gen' generations against its own.
+// The games of a generation are played in parallel, then scored in order.
 void Population::EvolveNN( int gen )
 {
-   Reversi game;
-   int wpc, bpc;                             // wpc/bpc = white/black piece count
-   NNComputer     computer_nn1( false );
-   NNComputer     computer_nn2( false );
-   Reversi::PlayerHandler* wp = 0;
-   Reversi::PlayerHandler* bp = 0;
+   ThreadPool pool( _threads );
    int best_offset = _size/2;
+   std::ofstream log;
+   if ( !_game_log.empty() ) log.open( _game_log.c_str(), std::ios::app );
 
    std::cout << "Starting evolution...\n";
    std::cout << "----------------------------------------------------------------------\n";
    for( int g=0; g<gen; ++g )
    {
    	std::cout << "GENERATION: " << _generation << "\n";
-      for( int i=0; i<_size-1; ++i )
-      {
-         int pl = i;
-         computer_nn1.SetNN( &_population[pl] );
-         for ( int j=i+1; j<_size; ++j )
-         {
-            int opp = j;
-            computer_nn2.SetNN( &_population[opp] );
-
-            // NN1 WHITE, NN2 BLACK
-            wpc = bpc = 0;
-            computer_nn1.SetColor( Reversi::WHITE );
-            computer_nn2.SetColor( Reversi::BLACK );
-            wp = &computer_nn1;
-            bp = &computer_nn2;
-            game.Start( *wp, *bp );
-            game.CountPieces( wpc, bpc );
-            _population[pl].pieces_won += wpc;
-            _population[pl].pieces_played += wpc+bpc;
-            _population[pl].games_played++;
-            _population[opp].pieces_won += bpc;
-            _population[opp].pieces_played += wpc+bpc;
-            _population[opp].games_played++;
-
-            std::cout << "[" << _generation << "] " << _population[pl].id << "[W] vs. " << _population[opp].id << "[B]. ";
-            if ( wpc > bpc )
-            {
-               // NN1 wins
-               _population[pl].fitness += FITNESS_WIN;
-               _population[pl].games_won++;
-               _population[opp].fitness += FITNESS_LOSE;
-               std::cout << "Result: " << _population[pl].id << " won. " << wpc << "-" << bpc << "\n";
-            }
-            else if ( wpc < bpc )
-            {
-               _population[pl].fitness += FITNESS_LOSE;
-               _population[opp].fitness += FITNESS_WIN;
-               _population[opp].games_won++;
-               std::cout << "Result: " << _population[opp].id << " won. " << wpc << "-" << bpc << "\n";
-            }
-            else
-            {
-               std::cout << "Result: DRAW. " << wpc << "-" << bpc << "\n";
-            }
-            
-
-            // swap sides
-            // NN1 BLACK, NN2 WHITE
-            wpc = bpc = 0;
-            computer_nn1.SetColor( Reversi::BLACK );
-            computer_nn2.SetColor( Reversi::WHITE );
-            wp = &computer_nn2;
-            bp = &computer_nn1;
-            game.Start( *wp, *bp );
-            game.CountPieces( wpc, bpc );
-            _population[pl].pieces_won += bpc;
-            _population[pl].pieces_played += wpc+bpc;
-            _population[pl].games_played++;
-            _population[opp].pieces_won += wpc;
-            _population[opp].pieces_played += wpc+bpc;
-            _population[opp].games_played++;
-            
-            std::cout << "[" << _generation << "] " << _population[pl].id << "[B] vs. " << _population[opp].id << "[W]. ";
-            if ( wpc > bpc )
-            {
-               _population[pl].fitness += FITNESS_LOSE;
-               _population[opp].fitness += FITNESS_WIN;
-               _population[opp].games_won++;
-               std::cout << "Result: " << _population[opp].id << " won. " << wpc << "-" << bpc << "\n";
-            }
-            else if ( wpc < bpc )
-            {
-               _population[pl].fitness += FITNESS_WIN;
-               _population[pl].games_won++;
-               _population[opp].fitness += FITNESS_LOSE;
-               std::cout << "Result: " << _population[pl].id << " won. " << wpc << "-" << bpc << "\n";
-            }
-            else
-            {
-               std::cout << "Result: DRAW. " << wpc << "-" << bpc << "\n";;
-            }
-         }
-      }
+
+      Tournament( pool, log );
+      _resume_games = 0;
       
       // sort individuals based on fitness level
       std::sort( _population.begin(), _population.end() );
+      Summarize( 2 );
       
       DisplayTop( best_offset );
       
       // clone the top 50%
-      Clone( best_offset );
+      Clone( best_offset, pool );
       
       _generation++;
+      log.flush();
+      if ( _checkpoint ) _checkpoint->Save( this, Progress( 0 ) );
    }
 
-   std::cout << "Measuring performance against a random mover 100 games:\n";
-   PlayARM( 100 );
+   if ( _measure_pairs > 0 )
+   {
+      std::cout << "Measuring performance against a random mover, up to " << _measure_pairs << " game pairs:\n";
+      PlayARM( _measure_pairs );
+   }
 
    std::cout << "Evolution Complete.\n";
 }
@@ -382,204 +1037,180 @@ void Population::EvolveNN( int gen )
 
 // EvolveRM()
 // Evolves population for 'gen' generations against the random mover.
+// The games of a generation are played in parallel, then scored in order.
 void Population::EvolveRM( int gen )
 {
-   Reversi game;
-   int wpc, bpc;                             // wpc/bpc = white/black piece count
-   NNComputer     computer_nn( false );
-   RandomComputer random_mover( false );
-   Reversi::PlayerHandler* wp = 0;
-   Reversi::PlayerHandler* bp = 0;
+   ThreadPool pool( _threads );
+   std::vector<Game> games;
    int best_offset = _size/2;
+   std::ofstream log;
+   if ( !_game_log.empty() ) log.open( _game_log.c_str(), std::ios::app );
 
    std::cout << "Starting evolution...\n";
    std::cout << "----------------------------------------------------------------------\n";
    for( int g=0; g<gen; ++g )
    {
    	std::cout << "GENERATION: " << _generation << "\n";
+
+      // 10 pairs of games with swapped sides for each individual
+      if ( _resume_games > 0 ) ResetFitness();
+      _resume_games = 0;
+      games.clear();
       for( int i=0; i<_size; ++i )
       {
-         int pl = i;
-         computer_nn.SetNN( &_population[pl] );
          for ( int j=0; j<10; ++j )
          {
-            int opp = j;
-
-            // NN1 WHITE, Random Mover BLACK
-            wpc = bpc = 0;
-            computer_nn.SetColor( Reversi::WHITE );
-            random_mover.SetColor( Reversi::BLACK );
-            wp = &computer_nn;
-            bp = &random_mover;
-            game.Start( *wp, *bp );
-            game.CountPieces( wpc, bpc );
-            _population[pl].pieces_won += wpc;
-            _population[pl].pieces_played += wpc+bpc;
-            _population[pl].games_played++;
-
-            std::cout << "[" << _generation << "] " << _population[pl].id << "[W] vs. Random Mover[B]. ";
-            if ( wpc > bpc )
-            {
-               // pl wins
-               _population[pl].fitness += FITNESS_WIN;
-               _population[pl].games_won++;
-               std::cout << "Result: " << _population[pl].id << " won. " << wpc << "-" << bpc << "\n";
-            }
-            else if ( wpc < bpc )
-            {
-               _population[pl].fitness += FITNESS_LOSE;
-               std::cout << "Result: Random Mover won. " << wpc << "-" << bpc << "\n";
-            }
-            else
-            {
-               std::cout << "Result: DRAW. " << wpc << "-" << bpc << "\n";
-            }
-            
-
-            // swap sides
-            // NN1 BLACK, Random Mover WHITE
-            wpc = bpc = 0;
-            computer_nn.SetColor( Reversi::BLACK );
-            random_mover.SetColor( Reversi::WHITE );
-            wp = &random_mover;
-            bp = &computer_nn;
-            game.Start( *wp, *bp );
-            game.CountPieces( wpc, bpc );
-            _population[pl].pieces_won += bpc;
-            _population[pl].pieces_played += wpc+bpc;
-            _population[pl].games_played++;
-            
-            std::cout << "[" << _generation << "] " << _population[pl].id << "[B] vs. Random Mover[W]. ";
-            if ( wpc > bpc )
-            {
-               _population[pl].fitness += FITNESS_LOSE;
-               std::cout << "Result: Random Mover won. " << wpc << "-" << bpc << "\n";
-            }
-            else if ( wpc < bpc )
-            {
-               _population[pl].fitness += FITNESS_WIN;
-               _population[pl].games_won++;
-               std::cout << "Result: " << _population[pl].id << " won. " << wpc << "-" << bpc << "\n";
-            }
-            else
-            {
-               std::cout << "Result: DRAW. " << wpc << "-" << bpc << "\n";;
-            }
+            AddGame( games, i, -1, true );
+            AddGame( games, i, -1, false );
          }
       }
+      PlayGames( games, pool );
+      for( unsigned int k=0; k<games.size(); ++k )
+         ScoreGame( games[k], ReportGame( games[k], log ) );
       
       // sort individuals based on fitness level
       std::sort( _population.begin(), _population.end() );
+      Summarize( 1 );
       
       DisplayTop( best_offset );
       
       // clone the top 50%
-      Clone( best_offset );
+      Clone( best_offset, pool );
       
       _generation++;
+      log.flush();
+      if ( _checkpoint ) _checkpoint->Save( this, Progress( 0 ) );
    }
 
-   std::cout << "Measuring performance against a random mover 100 games:\n";
-   PlayARM( 100 );
+   if ( _measure_pairs > 0 )
+   {
+      std::cout << "Measuring performance against a random mover, up to " << _measure_pairs << " game pairs:\n";
+      PlayARM( _measure_pairs );
+   }
 
    std::cout << "Evolution Complete.\n";
 }
 
 
-// PlayARM
-// Plays against the random mover for 'num'x2 games.
+// PlayARM()
+// Measures the first individual against the random mover, see MatchRunner: up to 'num'
+// pairs of games, stopping once its Elo difference is known to within MEASURE_ELO_ERROR.
 void Population::PlayARM( int num )
 {
-   Reversi game;
-   int wpc, bpc;           // wpc/bpc = white/black piece count
-   NNComputer     top_nn( false );
-   RandomComputer random_mover( false );
-   Reversi::PlayerHandler* wp = 0;
-   Reversi::PlayerHandler* bp = 0;
-
-   int win_count = 0;
-   int fitness = 0;
-   int play_count = 0;
-   int piece_won = 0;
-   int piece_played = 0;
-
-   top_nn.SetNN( &_population[0] );
-   for( int i=0; i<num; ++i )
-   {
-      // NN WHITE, Random Mover BLACK
-      wpc = bpc = 0;
-      top_nn.SetColor( Reversi::WHITE );
-      random_mover.SetColor( Reversi::BLACK );
-      wp = &top_nn;
-      bp = &random_mover;
-      game.Start( *wp, *bp );
-      game.CountPieces( wpc, bpc );
-      play_count++;
-      piece_played += wpc+bpc;
-      piece_won += wpc;
-
-      std::cout << "[" << _generation << "] " << _population[0].id << "[W] vs. Random Mover[B]. ";
-      if ( wpc > bpc )
-      {
-         win_count++;
-         fitness += FITNESS_WIN;
-         std::cout << "Result: " << _population[0].id << " won. " << wpc << "-" << bpc << "\n";
-      }
-      else if ( wpc < bpc )
-      {
-         fitness += FITNESS_LOSE;
-         std::cout << "Result: Random Mover won. " << wpc << "-" << bpc << "\n";
-      }
-      else
-      {
-         std::cout << "Result: DRAW. " << wpc << "-" << bpc << "\n";
-      }
+   MatchRunner runner;
+   runner.SetThreads( _threads );
+   runner.SetPairs( num );
+   runner.SetAdjudication( _solve_empties, _margin_empties, _margin );
+   runner.SetConfidence( MEASURE_ELO_ERROR );
+   runner.Play( MatchRunner::Network( &_population[0], 1 ), MatchRunner::RandomMover() );
+}
 
-      // swap sides
-      // NN BLACK, Random Mover WHITE
-      wpc = bpc = 0;
-      top_nn.SetColor( Reversi::BLACK );
-      random_mover.SetColor( Reversi::WHITE );
-      wp = &random_mover;
-      bp = &top_nn;
-      game.Start( *wp, *bp );
-      game.CountPieces( wpc, bpc );
-      play_count++;
-      piece_played += wpc+bpc;
-      piece_won += bpc;
-      
-      std::cout << "[" << _generation << "] " << _population[0].id << "[B] vs. Random Mover[W]. ";
-      if ( wpc > bpc )
-      {
-         fitness += FITNESS_LOSE;
-         std::cout << "Result: Random Mover won. " << wpc << "-" << bpc << "\n";
-      }
-      else if ( wpc < bpc )
-      {
-         win_count++;
-         fitness += FITNESS_WIN;
-         std::cout << "Result: " << _population[0].id << " won. " << wpc << "-" << bpc << "\n";
-      }
-      else
-      {
-         std::cout << "Result: DRAW. " << wpc << "-" << bpc << "\n";
-      }
-   }
 
-   double wcp = 100.0 * win_count / play_count;
-   double pcp = 100.0 * piece_won / piece_played;
-   std::cout << "Results:\n";
-   std::cout << "Fitness: " << fitness << "\n";
-   std::cout << "Win Count: " << win_count << "/" << play_count << "(" << wcp << ")\n";
-   std::cout << "Piece Count: " << piece_won << "/" << piece_played << "(" << pcp << ")\n";
-   std::cout.flush();
+// PlayAAB()
+// Measures the first individual against the heuristic alpha-beta mover searching MEASURE_AB_DEPTH
+// plies, as PlayARM().
+void Population::PlayAAB( int num )
+{
+   MatchRunner runner;
+   runner.SetThreads( _threads );
+   runner.SetPairs( num );
+   runner.SetAdjudication( _solve_empties, _margin_empties, _margin );
+   runner.SetConfidence( MEASURE_ELO_ERROR );
+   runner.Play( MatchRunner::Network( &_population[0], 1 ), MatchRunner::Heuristic( MEASURE_AB_DEPTH ) );
 }
 
 
-// PlayAAB
-// Plays against the alpha-beta mover for 'num'x2 games.
-void Population::PlayAAB( int num )
+// SetAdjudication()
+// Sets when tournament and benchmark games are stopped early: solved exactly at 'solve_empties'
+// empties or fewer, or won by the leader at 'margin_empties' empties or fewer with a lead of
+// at least 'margin' pieces. A 'margin' of 0 disables the disc-margin rule.
+void Population::SetAdjudication( int solve_empties, int margin_empties, int margin )
+{
+   _solve_empties = solve_empties;
+   _margin_empties = margin_empties;
+   _margin = margin;
+}
+
+
+// SetActivation()
+// Sets the hidden layer activation of all networks, now and after Restart() or Load(), in
+// place of the one saved with the population. One of ACTIVATION_* in kernel.h; the fast
+// ones trade accuracy for evaluation speed.
+void Population::SetActivation( int a )
+{
+   _activation = a;
+   _activation_set = true;
+   for( unsigned int i=0; i<_population.size(); ++i )
+      _population[i].nn.SetActivation( a );
+}
+
+// SetGameLog()
+// Appends every game played from now on to the file 'filename', one game per line: the final
+// white and black piece counts, then the moves. Passes are not listed. An empty name stops it.
+void Population::SetGameLog( const char* filename )
+{
+   _game_log = filename;
+}
+
+// LogGame()
+// Appends game 'g' to 'log', if it is open.
+void Population::LogGame( std::ofstream& log, const Population::Game& g )
+{
+   if ( !log.is_open() ) return;
+   log << g.wpc << " " << g.bpc;
+   for( unsigned int i=0; i<g.moves.size(); ++i )
+      log << " " << g.moves[i];
+   log << "\n";
+}
+
+// SetSwiss()
+// Makes the tournaments of EvolveNN Swiss tournaments of 'rounds' rounds, see Swiss(), instead of
+// full round robins. Each individual then plays about 'rounds' games instead of 2*(size-1).
+// 0 goes back to full round robins; a negative value takes 2*log2(size) rounds.
+void Population::SetSwiss( int rounds )
+{
+   _swiss_rounds = rounds;
+}
+
+// SetRacing()
+// Makes the round robins of EvolveNN races for the top half, see Race(), at a confidence of
+// 'z' standard errors. Individuals that are clearly in or out stop playing. 0 goes back to
+// full round robins. Swiss tournaments, see SetSwiss(), take precedence.
+void Population::SetRacing( double z )
 {
+   _racing_z = z;
+}
+
+// SetBinary()
+// Makes Save() write the binary format if 'binary', else the text format.
+void Population::SetBinary( bool binary )
+{
+   _binary = binary;
+}
+
+// SetCheckpoint()
+// Makes EvolveNN() and EvolveRM() write a checkpoint to 'checkpoint' after each generation,
+// and round robins also every 'pairings' pairings, 0 for none. 0 stops it.
+void Population::SetCheckpoint( Checkpointer* checkpoint, int pairings )
+{
+   _checkpoint = checkpoint;
+   _checkpoint_pairings = pairings;
+}
+
+// SetMeasure()
+// Makes EvolveNN() and EvolveRM() end with up to 'pairs' pairs of games against the random
+// mover, see PlayARM(), 0 for none.
+void Population::SetMeasure( int pairs )
+{
+   _measure_pairs = pairs;
+}
+
+// SetThreads()
+// Plays the games of tournaments on 'threads' threads, 0 for one per hardware thread.
+// Results do not depend on it.
+void Population::SetThreads( int threads )
+{
+   _threads = threads;
 }
 
 
@@ -597,3 +1228,17 @@ int Population::GetGeneration() const
 {
    return _generation;
 }
+
+// GetLayers()
+// Returns the layer setup of the networks of this population
+const char* Population::GetLayers() const
+{
+   return _nn_layers.c_str();
+}
+
+// LastGeneration()
+// Returns the results of the last generation evolved, with a generation of -1 if none
+const Population::GenerationStats& Population::LastGeneration() const
+{
+   return _last;
+}
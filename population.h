@@ -2,6 +2,11 @@
 #define POPULATION_H_
 
 #include "nn.h"
+#include "reversi.h"
+#include "random.h"
+
+class ThreadPool;
+class Checkpointer;
 
 class Population
 {
@@ -24,22 +29,99 @@ public:
       bool operator< ( const Individual& rhs );
    };
 
+   // A game of a tournament between individual 'a' and individual 'b' or, if 'b' is -1,
+   // the random mover, and once played its result.
+   struct Game
+   {
+      int a, b;
+      bool a_white;
+      RandomStream random;       // of the random mover
+      int wpc, bpc;              // white/black piece count
+      bool adjudicated;
+      std::vector<Reversi::index_type> moves;
+   };
+
+   // Results of a generation, taken before cloning.
+   struct GenerationStats
+   {
+      int generation;
+      int best_id;
+      int best_fitness;
+      int best_games_won;
+      int best_games_played;
+      double mean_fitness;
+      int games;
+   };
+
    std::vector<Individual>    _population;   // evolution
    
 private:
+   // A game between two networks, by their weight hashes and the settings it was played
+   // with, see PlayGames(). The one with the lower hash is 'a'.
+   struct Match
+   {
+      uint64_t a, b;
+      bool a_white;
+      uint64_t settings;
+
+      bool operator< ( const Match& rhs ) const;
+   };
+
    std::string                _nn_layers;    // NN layers setup
    int                        _next_id;      // ID to be assigned for the next individual
    int                        _size;         // size of population
    int                        _generation;   // generation #
+
+   int                        _solve_empties;   // adjudication: exact solve at this many empties
+   int                        _margin_empties;  // adjudication: disc-margin rule at this many empties
+   int                        _margin;          // adjudication: disc-margin, 0 to disable
+   int                        _activation;      // hidden layer activation of all networks
+   bool                       _activation_set;  // by SetActivation(), else taken from the file by Load()
+   std::string                _game_log;        // file the games are appended to, none if empty
+   int                        _threads;         // tournament threads, 0 for one per hardware thread
+   int                        _swiss_rounds;    // rounds of Swiss tournaments, 0 for round robins
+   double                     _racing_z;        // confidence of races, in standard errors, 0 for none
+   bool                       _binary;          // Save() writes the binary format, see popfile.h
+   Checkpointer*              _checkpoint;      // checkpoints are written to it, none if 0
+   int                        _checkpoint_pairings;   // round robin pairings between two checkpoints, 0 for none
+   int                        _resume_games;    // games of this generation already played, see Resume()
+   int                        _measure_pairs;   // game pairs against the random mover after evolving
+   GenerationStats            _last;            // of the last generation evolved
+   std::map<Match, Game>      _matches;         // results of the games between networks, kept across generations
+   std::vector<uint64_t>      _hashes;          // weight hash of each individual during a tournament
+   int                        _reused;          // games of the current tournament taken from _matches
    
-   void Clone( int n );
+   void Clone( int n, ThreadPool& pool );
+   void ResetFitness();
+   uint64_t Settings() const;
+   Match GetMatch( const Game& g ) const;
+   void PruneMatches();
+   void Summarize( int players );
+   bool LoadBinary( const char* filename );
+   bool SaveBinary( const char* filename );
+   void AddGame( std::vector<Game>& games, int a, int b, bool a_white );
+   void PlayGames( std::vector<Game>& games, ThreadPool& pool, int first = 0, int last = -1 );
+   int ReportGame( const Game& g, std::ofstream& log );
+   void ScoreGame( const Game& g, int result );
+   void Tournament( ThreadPool& pool, std::ofstream& log );
+   void Swiss( int rounds, ThreadPool& pool, std::ofstream& log );
+   void Race( ThreadPool& pool, std::ofstream& log );
+   void LogGame( std::ofstream& log, const Game& g );
    void DisplayTop( int n );
    
 public:
+   Population();
+
    bool Restart( const char* filename );
    bool Load( const char* filename );
    bool Save( const char* filename );
+   void Assign( const char* layers, const NeuralNetwork& nn );
+   std::string Progress( int games ) const;
+   bool Resume( const char* filename );
+   void Truncate( int size );
+   bool Immigrate( const Population& migrants );
    
+   void Rank();
    void EvolveNN( int gen );
    void EvolveRM( int gen );
    void EvolveAB( int gen );
@@ -47,8 +129,20 @@ public:
    void PlayARM( int num );
    void PlayAAB( int num );
 
+   void SetAdjudication( int solve_empties, int margin_empties, int margin );
+   void SetActivation( int a );
+   void SetGameLog( const char* filename );
+   void SetThreads( int threads );
+   void SetSwiss( int rounds );
+   void SetRacing( double z );
+   void SetBinary( bool binary );
+   void SetCheckpoint( Checkpointer* checkpoint, int pairings );
+   void SetMeasure( int pairs );
+
    int GetSize() const;
    int GetGeneration() const;
+   const char* GetLayers() const;
+   const GenerationStats& LastGeneration() const;
 };
 
 #endif
@@ -0,0 +1,107 @@
+#include "lib.h"
+#include "qnn.h"
+#include "kernel.h"
+
+const int    ACT_ONE     = 256;      // fixed point 1.0 of the activations
+const int    WEIGHT_MAX  = 127;      // largest int8 weight
+const double LUT_RANGE   = 16.0;     // activation tables cover [-LUT_RANGE,LUT_RANGE)
+const int    LUT_STEPS   = 64;       // table entries per unit
+const int    LUT_SIZE    = int(2*LUT_RANGE)*LUT_STEPS;
+
+
+// ActivationTable()
+// Returns the lookup table of activation 'a' (ACTIVATION_* in kernel.h), entry 'i' holding
+// the activation at the middle of its interval. Tables are built on first use, by Build().
+static const std::vector<short>& ActivationTable( int a )
+{
+   static std::vector<short> tables[ACTIVATION_HARD+1];
+   if ( a < ACTIVATION_EXACT || a > ACTIVATION_HARD ) a = ACTIVATION_EXACT;    // as ActivationVector()
+   std::vector<short>& table = tables[a];
+   if ( table.empty() )
+   {
+      std::vector<double> x( LUT_SIZE );
+      for( int i=0; i<LUT_SIZE; ++i )
+         x[i] = -LUT_RANGE + (i+0.5)/LUT_STEPS;
+      ActivationVector( a, &x[0], LUT_SIZE );
+      table.resize( LUT_SIZE );
+      for( int i=0; i<LUT_SIZE; ++i )
+         table[i] = short(floor(ACT_ONE*x[i] + 0.5));
+   }
+   return table;
+}
+
+
+QuantizedNetwork::QuantizedNetwork() : _layer_count(0), _nodes_count(0), _widest(0), _table(0)
+{
+}
+
+// Build()
+// Quantises the weights of 'nn'. Each layer is scaled so its largest weight maps to WEIGHT_MAX.
+// The hidden layers use a table of the activation of 'nn'.
+void QuantizedNetwork::Build( const NeuralNetwork& nn )
+{
+   const NeuralNetwork::nodes_type& matrix = nn.GetMatrix();
+   _layer_info = nn.GetLayerInfo();
+   _layer_count = nn.LayerCount();
+   _weights.resize( matrix.size() );
+   _scale.resize( _layer_count-1 );
+   _nodes_count = nn.NodesCount();
+
+   int pwc = 0;
+   _widest = 0;
+   for( int l=0; l<_layer_count-1; ++l )
+   {
+      int wtl = _layer_info[l] * _layer_info[l+1];
+      double max_w = 0.0;
+      for( int w=0; w<wtl; ++w )
+         max_w = std::max( max_w, fabs(matrix[pwc+w]) );
+      double s = ( max_w > 0.0 ) ? WEIGHT_MAX/max_w : 1.0;
+      for( int w=0; w<wtl; ++w )
+         _weights[pwc+w] = (signed char)floor(matrix[pwc+w]*s + 0.5);
+      _scale[l] = 1.0/(s*ACT_ONE);
+      _widest = std::max( _widest, _layer_info[l+1] );
+      pwc += wtl;
+   }
+   _table = &ActivationTable( nn.GetActivation() );
+}
+
+// Evaluate()
+// Feeds 'input' forward and returns the output, matching NeuralNetwork::GetOutput().
+NeuralNetwork::value_type QuantizedNetwork::Evaluate( QuantizedNetwork::Context& ctx, const NeuralNetwork::nodes_type& input ) const
+{
+   const std::vector<short>& table = *_table;
+   ctx.nodes.resize( _nodes_count );
+   ctx.sums.resize( _widest );
+   for( int i=0; i<_layer_info[0]; ++i )
+      ctx.nodes[i] = short(floor(input[i]*ACT_ONE + 0.5));
+
+   short* in = &ctx.nodes[0];
+   short* out = in + _layer_info[0];
+   const signed char* w = &_weights[0];
+   int l = 0;
+   for( ; l<_layer_count-2; ++l )
+   {
+      int prev = _layer_info[l], next = _layer_info[l+1];
+      GemvInt8( w, in, &ctx.sums[0], next, prev );
+      for( int d=0; d<next; ++d )
+      {
+         int i = int(floor((ctx.sums[d]*_scale[l] + LUT_RANGE)*LUT_STEPS));
+         out[d] = table[ (i < 0) ? 0 : (i >= LUT_SIZE) ? LUT_SIZE-1 : i ];
+      }
+      w += prev*next;
+      in = out;
+      out += next;
+   }
+
+   // output layer, only the last node is used
+   int prev = _layer_info[l], next = _layer_info[l+1];
+   GemvInt8( w, in, &ctx.sums[0], next, prev );
+   return 1.0/(1.0+exp(-ctx.sums[next-1]*_scale[l]/8.0));
+}
+
+// MemorySize()
+// Returns the number of bytes taken by the weights.
+int QuantizedNetwork::MemorySize() const
+{
+   return int(_weights.size()*sizeof(signed char) + _scale.size()*sizeof(double));
+}
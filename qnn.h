@@ -0,0 +1,36 @@
+#ifndef ALNITE_QNN_H_
+#define ALNITE_QNN_H_
+
+#include "nn.h"
+
+// Quantised copy of a NeuralNetwork for fast inference.
+// Weights are int8 with one scale per layer, activations int16 fixed point and sums int32.
+// Hidden activations come from a lookup table of the network's activation.
+class QuantizedNetwork
+{
+public:
+   // Activations of one evaluation, one per thread as with NeuralNetwork::Context
+   struct Context
+   {
+      std::vector<short>            nodes;         // int16 activations of all layers
+      std::vector<int>              sums;          // int32 sums of the current layer
+   };
+
+private:
+   std::vector<signed char>         _weights;      // int8 weights, laid out as NeuralNetwork::GetMatrix()
+   std::vector<double>              _scale;        // per layer, turns an int32 sum back to a real value
+   NeuralNetwork::layer_info_type   _layer_info;
+   int                              _layer_count;
+   int                              _nodes_count;
+   int                              _widest;       // nodes in the widest layer after the inputs
+   const std::vector<short>*        _table;        // hidden activation, see ActivationTable() in qnn.cpp
+
+public:
+   QuantizedNetwork();
+
+   void Build( const NeuralNetwork& nn );
+   NeuralNetwork::value_type Evaluate( Context& ctx, const NeuralNetwork::nodes_type& input ) const;
+   int MemorySize() const;
+};
+
+#endif
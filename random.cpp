@@ -0,0 +1,183 @@
+#include "lib.h"
+#include "random.h"
+#include "kernel.h"
+#include <atomic>
+
+const int    ZIGGURAT_LAYERS = 128;
+const double ZIGGURAT_R      = 3.442619855899;       // start of the tail
+const double ZIGGURAT_V      = 9.91256303526217e-3;  // area of each layer
+const int    GAUSSIAN_BATCH  = 256;                  // draws hashed at once by Gaussians()
+
+const uint64_t TASK_DOMAIN   = 0x7461736b73ULL;      // keeps task streams apart from thread streams
+
+uint64_t                master_seed = 0;
+std::atomic<uint64_t>   next_thread( 1 );           // stream of the next thread to draw
+
+// Ziggurat tables for the normal distribution, after Doornik, "An Improved Ziggurat Method to
+// Generate Normal Random Samples" (2005): the right edge of each layer, and the ratio of the
+// next edge to it, below which a sample is inside the layer's rectangle.
+struct ZigguratTables
+{
+   double x[ZIGGURAT_LAYERS+1];
+   double r[ZIGGURAT_LAYERS];
+
+   ZigguratTables()
+   {
+      double f = exp( -0.5*ZIGGURAT_R*ZIGGURAT_R );
+      x[0] = ZIGGURAT_V/f;          // the bottom layer, rectangle and tail
+      x[1] = ZIGGURAT_R;
+      x[ZIGGURAT_LAYERS] = 0.0;
+      for( int i=2; i<ZIGGURAT_LAYERS; ++i )
+      {
+         x[i] = sqrt( -2.0*log( ZIGGURAT_V/x[i-1] + f ) );
+         f = exp( -0.5*x[i]*x[i] );
+      }
+      for( int i=0; i<ZIGGURAT_LAYERS; ++i )
+         r[i] = x[i+1]/x[i];
+   }
+};
+
+const ZigguratTables zig;
+
+inline uint64_t mix( uint64_t z )
+{
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}
+
+
+// Substream()
+// Returns the stream 'n' derived from this one. Does not draw from this one.
+RandomStream RandomStream::Substream( uint64_t n ) const
+{
+   return RandomStream( mix( _key ^ mix( n + 0x9e3779b97f4a7c15ULL ) ) );
+}
+
+// Split()
+// Draws a new stream from this one.
+RandomStream RandomStream::Split()
+{
+   return RandomStream( Next() );
+}
+
+// Gaussian()
+// Returns a normally distributed number with zero mean and unit variance, by the ziggurat
+// method: one 64-bit draw gives both the layer and the position, and almost always falls
+// inside the layer's rectangle.
+double RandomStream::Gaussian()
+{
+   double x;
+   while ( !_Ziggurat( Next(), x ) ) {}
+   return x;
+}
+
+// Gaussians()
+// Fills 'out' with 'n' numbers, the same as 'n' calls of Gaussian(). The draws are hashed
+// ahead in batches by the vector kernels; the few that fall outside their rectangle are
+// finished one draw at a time, and the batch goes on after the draws they took.
+void RandomStream::Gaussians( double* out, int n )
+{
+   uint64_t bits[GAUSSIAN_BATCH];
+   int k = 0;
+   while ( k < n )
+   {
+      // at least one draw for each number still to go
+      uint64_t first = _counter;
+      int m = std::min( n-k, GAUSSIAN_BATCH );
+      HashVector( _key, first+1, bits, m );
+
+      int t = 0;
+      while ( t < m && k < n )
+      {
+         uint64_t b = bits[t++];
+         int i = int( b & (ZIGGURAT_LAYERS-1) );
+         double u = 2.0*( double(b >> 11) + 0.5 )*(1.0/9007199254740992.0) - 1.0;
+         if ( fabs(u) < zig.r[i] )
+         {
+            out[k++] = u*zig.x[i];
+            continue;
+         }
+         _counter = first + t;
+         double x;
+         while ( !_Ziggurat( b, x ) ) b = Next();
+         out[k++] = x;
+         t = int( _counter - first );
+      }
+      _counter = first + t;
+   }
+}
+
+// _Ziggurat()
+// Tries the draw 'bits' for Gaussian(), drawing more from this stream in the tail and the
+// wedges. Returns true with the number in 'x', or false to try again with the next draw.
+bool RandomStream::_Ziggurat( uint64_t bits, double& x )
+{
+   int i = int( bits & (ZIGGURAT_LAYERS-1) );
+   double u = 2.0*( double(bits >> 11) + 0.5 )*(1.0/9007199254740992.0) - 1.0;
+   if ( fabs(u) < zig.r[i] )
+   {
+      x = u*zig.x[i];
+      return true;
+   }
+
+   // the tail, beyond the bottom layer
+   if ( i == 0 )
+   {
+      double y;
+      do
+      {
+         x = log( Uniform() )/ZIGGURAT_R;
+         y = log( Uniform() );
+      } while ( -2.0*y < x*x );
+      x = ( u < 0 ) ? x-ZIGGURAT_R : ZIGGURAT_R-x;
+      return true;
+   }
+
+   // the wedge right of the rectangle
+   x = u*zig.x[i];
+   double f0 = exp( -0.5*( zig.x[i]*zig.x[i] - x*x ) );
+   double f1 = exp( -0.5*( zig.x[i+1]*zig.x[i+1] - x*x ) );
+   return f1 + Uniform()*(f0-f1) < 1.0;
+}
+
+
+// thread streams, made on the thread's first draw
+thread_local bool          thread_ready = false;
+thread_local RandomStream  thread_stream;
+
+// SetMasterSeed()
+// Sets the seed all streams derive from. The calling thread gets stream 0; other threads get
+// theirs when they first draw, so the seed is best set before starting them.
+void SetMasterSeed( uint64_t seed )
+{
+   master_seed = seed;
+   next_thread = 1;
+   thread_stream = RandomStream( mix( seed ) ).Substream( 0 );
+   thread_ready = true;
+}
+
+uint64_t MasterSeed()
+{
+   return master_seed;
+}
+
+// ThreadRandom()
+// Returns the stream of the calling thread.
+RandomStream& ThreadRandom()
+{
+   if ( !thread_ready )
+   {
+      thread_stream = RandomStream( mix( master_seed ) ).Substream( next_thread++ );
+      thread_ready = true;
+   }
+   return thread_stream;
+}
+
+// TaskStream()
+// Returns the stream of task 'task', for work whose numbers must not depend on which thread
+// runs it or when.
+RandomStream TaskStream( uint64_t task )
+{
+   return RandomStream( mix( master_seed ^ TASK_DOMAIN ) ).Substream( task );
+}
@@ -0,0 +1,63 @@
+#ifndef ALNITE_RANDOM_H_
+#define ALNITE_RANDOM_H_
+
+#include <stdint.h>
+
+// Counter-based random numbers. The n-th number of a stream is a hash of the stream's key
+// and n, so streams cost nothing to make, do not depend on each other, and give the same
+// numbers whichever thread draws them. All streams derive from the master seed, so a run is
+// reproduced by its seed:
+//   - each thread has a stream of its own, ThreadRandom(), behind randf() and gaussrandf();
+//     the thread that sets the seed gets stream 0, the others the next ones as they first draw,
+//   - work that must not depend on scheduling takes a stream per task, TaskStream(), or one
+//     split off a stream in a fixed order, Split().
+class RandomStream
+{
+   uint64_t _key;
+   uint64_t _counter;
+
+   bool _Ziggurat( uint64_t bits, double& x );
+
+public:
+   explicit RandomStream( uint64_t key = 0 ) : _key(key), _counter(0) {}
+
+   RandomStream Substream( uint64_t n ) const;
+   RandomStream Split();
+
+   // At()
+   // Returns the 64 random bits of draw 'n', the first being 1. HashVector() in kernel.h
+   // computes the same for many draws at once.
+   uint64_t At( uint64_t n ) const
+   {
+      uint64_t z = _key + n*0x9e3779b97f4a7c15ULL;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      z ^= (z >> 31) ^ _key;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+   }
+
+   // Next()
+   // Returns the next 64 random bits.
+   uint64_t Next() { return At( ++_counter ); }
+
+   // Uniform()
+   // Returns a random number (0.0,1.0).
+   double Uniform()
+   {
+      return ( double(Next() >> 11) + 0.5 ) * (1.0/9007199254740992.0);
+   }
+
+   double Uniform( double min, double max ) { return min + (max-min)*Uniform(); }
+   int Below( int n ) { return int( Uniform()*n ); }
+   double Gaussian();
+   void Gaussians( double* out, int n );
+};
+
+void SetMasterSeed( uint64_t seed );
+uint64_t MasterSeed();
+RandomStream& ThreadRandom();
+RandomStream TaskStream( uint64_t task );
+
+#endif
@@ -59,6 +59,9 @@ Reversi::Reversi() : _reversi(BOARD_SIZE)
 {
    _endgame_func = 0;
    _startgame_func = 0;
+   _adjudicator = 0;
+   _adjudicated = false;
+   _adj_white = _adj_black = 0;
 }
 
 
@@ -78,6 +81,8 @@ void Reversi::Start( Reversi::PlayerHandler& w, Reversi::PlayerHandler& b )
 
    // trigger event
    _running = true;
+   _adjudicated = false;
+   _moves.clear();
    if ( _startgame_func ) (*_startgame_func)(_reversi);
 
    // run game
@@ -87,16 +92,24 @@ void Reversi::Start( Reversi::PlayerHandler& w, Reversi::PlayerHandler& b )
    index_type move;
    while ( _running )
    {
+      if ( _adjudicator && (*_adjudicator)(_reversi,BLACK,_adj_white,_adj_black) )
+      { _adjudicated = true; End(); break; }
+
       if ( (black_avail = MoveAvailable(_reversi,BLACK,black_moves)) )
       {
          do { move = black_func(_reversi,black_moves); }
          while ( !Perform(_reversi,BLACK,move) );
+         _moves.push_back( move );
       }
 
+      if ( _adjudicator && (*_adjudicator)(_reversi,WHITE,_adj_white,_adj_black) )
+      { _adjudicated = true; End(); break; }
+
       if ( (white_avail = MoveAvailable(_reversi,WHITE,white_moves)) )
       {
          do { move = white_func(_reversi,white_moves); }
          while ( !Perform(_reversi,WHITE,move) );
+         _moves.push_back( move );
       }
 
       if ( !(black_avail || white_avail) ) { End(); break; }
@@ -157,6 +170,18 @@ Reversi::index_type Reversi::_Finds( const Reversi::board_type& board, Reversi::
 }
 
 
+// _Flips()
+// Finds if placing a piece for player 'player' at 'start' flips pieces in the direction of 'dy'.
+bool Reversi::_Flips( const Reversi::board_type& board, Reversi::value_type player, Reversi::index_type start, int dy )
+{
+   value_type opp_pl = ( player == BLACK ) ? WHITE : BLACK;
+   index_type j = int(start + dy);
+   if ( board[j] != opp_pl ) return false;
+   do { j += dy; } while ( board[j] == opp_pl );
+   return board[j] == player;
+}
+
+
 // SetStartHandler(), SetEndHandler()
 // Set game event handlers
 void Reversi::SetStartHandler( Reversi::GameEventHandler* h )
@@ -170,10 +195,20 @@ void Reversi::SetEndHandler( Reversi::GameEventHandler* h )
 }
 
 
+// SetAdjudicator()
+// Sets the adjudicator consulted before every move. Pass 0 to always play games to the end.
+void Reversi::SetAdjudicator( Reversi::Adjudicator* a )
+{
+   _adjudicator = a;
+}
+
+
 // CountPieces()
 // Counts the pieces of white and black players to to 'w' and 'b', respectively.
+// If the last game was adjudicated, returns the adjudicated result instead.
 void Reversi::CountPieces( int& w, int& b ) const
 {
+   if ( _adjudicated ) { w = _adj_white; b = _adj_black; return; }
    w = b = 0;
    value_type v;
    for( index_type i=11; i<89; ++i )
@@ -185,6 +220,22 @@ void Reversi::CountPieces( int& w, int& b ) const
 }
 
 
+// Adjudicated()
+// Returns true if the last game was stopped early by the adjudicator.
+bool Reversi::Adjudicated() const
+{
+   return _adjudicated;
+}
+
+// GetMoves()
+// Returns the moves of the last game in the order they were played. A player without a
+// move passes, which is not listed.
+const std::vector<Reversi::index_type>& Reversi::GetMoves() const
+{
+   return _moves;
+}
+
+
 // Perform()
 // Checks for valid moves at 'i' for player 'player' and switches opponent pieces if found.
 // Returns true if a move can be performed, false otherwise
@@ -237,6 +288,26 @@ bool Reversi::MoveAvailable( const Reversi::board_type& board, Reversi::value_ty
 }
 
 
+// GenerateMoves()
+// Same moves as MoveAvailable() in the same (ascending) order, written to 'moves'
+// without allocating. 'moves' must hold MAX_MOVES entries.
+// Returns the number of moves.
+int Reversi::GenerateMoves( const Reversi::board_type& board, Reversi::value_type player, Reversi::index_type* moves )
+{
+   int count = 0;
+   for ( index_type i=11; i<89; ++i )
+   {
+      if ( board[i] != EMPTY || i%10 == 0 || i%10 == 9 ) continue;
+      if ( _Flips(board, player, i, -10) || _Flips(board, player, i, +10) ||
+           _Flips(board, player, i,  -1) || _Flips(board, player, i,  +1) ||
+           _Flips(board, player, i, -11) || _Flips(board, player, i, +11) ||
+           _Flips(board, player, i,  -9) || _Flips(board, player, i,  +9) )
+         moves[count++] = i;
+   }
+   return count;
+}
+
+
 // GetBoard()
 // Returns the content of the whole 10x10 board.
 Reversi::board_type Reversi::GetBoard() const
@@ -17,6 +17,7 @@ public:
    static const value_type EMPTY;
    static const value_type WHITE;
    static const value_type BLACK;
+   static const int MAX_MOVES = 64;
 
    class PlayerHandler
    {
@@ -30,16 +31,30 @@ public:
       virtual void operator() (const Reversi::board_type&) = 0;
    };
 
+   class Adjudicator
+   {
+   public:
+      // Returns true if the game can be decided now with 'player' to move, giving the final
+      // white and black piece counts.
+      virtual bool operator() (const Reversi::board_type&, value_type player, int& w, int& b) = 0;
+   };
+
 private:
    board_type  _reversi;
    index_type  _board_size;
    bool        _running;
+   bool        _adjudicated;
+   int         _adj_white;
+   int         _adj_black;
+   std::vector<index_type> _moves;     // moves of the last game, passes left out
 
    GameEventHandler*  _endgame_func;
    GameEventHandler*  _startgame_func;
+   Adjudicator*       _adjudicator;
 
    static bool _Switch( board_type&, value_type player, index_type start, int dy );
    static index_type _Finds( const board_type&, value_type player, index_type start, int dy );
+   static bool _Flips( const board_type&, value_type player, index_type start, int dy );
 
 public:
    Reversi();
@@ -47,11 +62,15 @@ public:
    void Start( PlayerHandler& w, PlayerHandler& b );
    void SetStartHandler( GameEventHandler* );
    void SetEndHandler( GameEventHandler* );
+   void SetAdjudicator( Adjudicator* );
    void End();
    void CountPieces( int& w, int& b ) const;
+   bool Adjudicated() const;
+   const std::vector<index_type>& GetMoves() const;
    
    static bool Perform( board_type&, value_type, index_type );
    static bool MoveAvailable( const board_type&, value_type, move_list& );
+   static int GenerateMoves( const board_type&, value_type, index_type* );
    
    board_type GetBoard() const;
 };
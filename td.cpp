@@ -0,0 +1,183 @@
+#include "lib.h"
+#include "td.h"
+#include "handler.h"
+#include "common.h"
+
+const int    TD_DEPTH    = 1;
+const int    TD_OPENING  = 4;
+const double TD_EXPLORE  = 0.05;
+const double TD_LAMBDA   = 0.7;
+const double TD_RATE     = 1.0;
+const int    TD_BATCH    = 4;
+
+
+// Moves at random for the first 'opening' moves of the game and with probability 'explore'
+// afterwards, otherwise with 'handler'.
+class SelfPlayExplorer : public Reversi::PlayerHandler
+{
+   Reversi::PlayerHandler* _handler;
+   int                     _opening;
+   double                  _explore;
+   RandomStream&           _random;
+
+public:
+   SelfPlayExplorer( Reversi::PlayerHandler* handler, int opening, double explore, RandomStream& random ) :
+   _handler(handler), _opening(opening), _explore(explore), _random(random)
+   {
+   }
+
+   Reversi::index_type operator()( const Reversi::board_type& board, Reversi::move_list& moves )
+   {
+      int discs = 0;
+      for( int i=11; i<89; ++i )
+         if ( board[i] != Reversi::EMPTY ) discs++;
+      if ( discs-4 >= _opening && _random.Uniform() >= _explore )
+         return (*_handler)( board, moves );
+
+      Reversi::move_list::iterator it = moves.begin();
+      std::advance( it, _random.Below( int(moves.size()) ) );
+      return *it;
+   }
+};
+
+
+TDTrainer::TDTrainer( Population::Individual* ind ) :
+_ind(ind), _threads(0), _depth(TD_DEPTH), _opening(TD_OPENING), _explore(TD_EXPLORE),
+_lambda(TD_LAMBDA), _rate(TD_RATE), _batch(TD_BATCH)
+{
+   SetThreads( 1 );
+}
+
+// SetThreads()
+// Plays the self-play games on 'threads' threads, 0 for one per hardware thread.
+void TDTrainer::SetThreads( int threads )
+{
+   if ( threads <= 0 ) threads = HardwareThreads();
+   _threads = threads;
+   _workers.resize( _threads );
+   for( int t=0; t<_threads; ++t )
+      _workers[t].random = ThreadRandom().Split();
+}
+
+// SetSelfPlay()
+// Self-play games search 'depth' plies, start with 'opening' random moves and
+// then play a random move with probability 'explore'.
+void TDTrainer::SetSelfPlay( int depth, int opening, double explore )
+{
+   _depth = depth;
+   _opening = opening;
+   _explore = explore;
+}
+
+// SetLearning()
+// Sets the trace decay 'lambda', the step 'rate' of the weight change of a game, and the
+// number of games each thread plays between two changes of the weights.
+void TDTrainer::SetLearning( double lambda, double rate, int batch )
+{
+   _lambda = lambda;
+   _rate = rate;
+   _batch = batch;
+}
+
+// _Play()
+// Plays the games of worker 'w' and adds up their weight changes. Runs on the worker's thread.
+void TDTrainer::_Play( Worker* w )
+{
+   NNComputer white( false ), black( false );
+   white.SetNN( _ind ); white.SetDepth( _depth ); white.SetColor( Reversi::WHITE );
+   black.SetNN( _ind ); black.SetDepth( _depth ); black.SetColor( Reversi::BLACK );
+   SelfPlayExplorer white_exp( &white, _opening, _explore, w->random ), black_exp( &black, _opening, _explore, w->random );
+
+   NeuralNetwork::Context ctx;
+   NeuralNetwork::nodes_type input, grad;
+   w->delta.assign( _ind->nn.WeightCount(), 0.0 );
+   w->positions = 0;
+   Reversi game;
+   for( int g=0; g<w->games; ++g )
+   {
+      game.Start( white_exp, black_exp );
+      _Learn( *w, game, ctx, input, grad );
+   }
+}
+
+// operator()
+// Task 'task' of a batch: plays the games of that worker.
+void TDTrainer::operator()( int task, int )
+{
+   _Play( &_workers[task] );
+}
+
+// _Learn()
+// Adds the weight change of 'game', just played, to worker 'w'. Each position after a move
+// moves by the sum of the following temporal differences, decayed by lambda per move.
+void TDTrainer::_Learn( Worker& w, const Reversi& game, NeuralNetwork::Context& ctx,
+                        NeuralNetwork::nodes_type& input, NeuralNetwork::nodes_type& grad )
+{
+   // replay the game into the positions after each move
+   std::vector<Reversi::board_type> boards;
+   Reversi::board_type board( 100, Reversi::EMPTY );
+   board[44] = board[55] = Reversi::WHITE;
+   board[45] = board[54] = Reversi::BLACK;
+   Reversi::value_type player = Reversi::BLACK;
+   Reversi::move_list moves;
+   const std::vector<Reversi::index_type>& played = game.GetMoves();
+   for( unsigned int m=0; m<played.size(); ++m )
+   {
+      if ( !Reversi::MoveAvailable( board, player, moves ) )
+         player = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+      Reversi::Perform( board, player, played[m] );
+      player = ( player == Reversi::BLACK ) ? Reversi::WHITE : Reversi::BLACK;
+      boards.push_back( board );
+   }
+
+   int wc, bc;
+   game.CountPieces( wc, bc );
+   const NeuralNetwork& nn = _ind->nn;
+   int count = int(boards.size()), weights = nn.WeightCount();
+   for( int side=0; side<2; ++side )
+   {
+      Reversi::value_type pl = side ? Reversi::BLACK : Reversi::WHITE;
+      int mine = side ? bc : wc, theirs = side ? wc : bc;
+      NeuralNetwork::value_type next = ( mine > theirs ) ? 1.0 : ( mine == theirs ) ? 0.5 : 0.0;
+
+      // backwards, so that the decayed sum of the differences that follow is at hand
+      NeuralNetwork::value_type trace = 0.0;
+      for( int t=count-1; t>=0; --t )
+      {
+         TranslateBoardtoNN( boards[t], pl, input );
+         nn.Input( ctx, input );
+         nn.FeedForward( ctx );
+         NeuralNetwork::value_type value = nn.GetOutput( ctx );
+         trace = ( next - value ) + _lambda*trace;
+         next = value;
+         nn.Gradient( ctx, grad );
+         for( int i=0; i<weights; ++i )
+            w.delta[i] += trace*grad[i];
+      }
+   }
+   w.positions += 2*count;
+}
+
+// Train()
+// Plays 'games' self-play games and learns from them. Returns the number of positions learnt from.
+int TDTrainer::Train( int games )
+{
+   int positions = 0;
+   ThreadPool pool( _threads );
+   while ( games > 0 )
+   {
+      // share the batch out
+      int batch = std::min( games, _threads*_batch );
+      for( int t=0; t<_threads; ++t )
+         _workers[t].games = batch/_threads + ( t < batch%_threads ? 1 : 0 );
+      pool.Run( *this, _threads );
+
+      for( int t=0; t<_threads; ++t )
+      {
+         _ind->nn.AdjustMatrix( _workers[t].delta, _rate/batch );
+         positions += _workers[t].positions;
+      }
+      games -= batch;
+   }
+   return positions;
+}
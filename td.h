@@ -0,0 +1,52 @@
+#ifndef ALNITE_TD_H_
+#define ALNITE_TD_H_
+
+#include "reversi.h"
+#include "nn.h"
+#include "population.h"
+#include "threadpool.h"
+#include "random.h"
+
+// Temporal difference learning, TD(lambda), of a network by self-play. After each game the
+// network is moved, along its gradient, from the value of every position towards the values
+// that follow it, down to the result of the game (1 won, 1/2 drawn, 0 lost), from both
+// players' point of view. Games are played by several threads, each with its own players,
+// against the network as it was at the start of the batch; their changes are then added up.
+class TDTrainer : private ThreadPool::Job
+{
+   struct Worker
+   {
+      RandomStream               random;     // of the worker's random moves
+      int                        games;      // to play in this batch
+      int                        positions;  // learnt from in this batch
+      NeuralNetwork::nodes_type  delta;      // weight change of this batch
+   };
+
+   Population::Individual* _ind;
+   int                     _threads;
+   int                     _depth;           // search depth of the self-play games
+   int                     _opening;         // random moves at the start of each game
+   double                  _explore;         // chance of a random move afterwards
+   double                  _lambda;
+   double                  _rate;
+   int                     _batch;           // games per thread between weight changes
+   std::vector<Worker>     _workers;
+
+   void _Play( Worker* w );
+   void operator()( int task, int thread );
+   void _Learn( Worker& w, const Reversi& game, NeuralNetwork::Context& ctx,
+                NeuralNetwork::nodes_type& input, NeuralNetwork::nodes_type& grad );
+
+   TDTrainer( const TDTrainer& );
+   TDTrainer& operator=( const TDTrainer& );
+
+public:
+   TDTrainer( Population::Individual* ind );
+
+   void SetThreads( int threads );
+   void SetSelfPlay( int depth, int opening, double explore );
+   void SetLearning( double lambda, double rate, int batch );
+   int Train( int games );
+};
+
+#endif
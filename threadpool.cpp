@@ -0,0 +1,82 @@
+#include "lib.h"
+#include "threadpool.h"
+
+// ThreadPool()
+// Starts 'threads' threads, the caller included; 0 for one per hardware thread.
+ThreadPool::ThreadPool( int threads ) :
+_job(0), _count(0), _next(0), _running(0), _round(0), _quit(false)
+{
+   if ( threads <= 0 ) threads = HardwareThreads();
+   for( int t=1; t<threads; ++t )
+      _threads.push_back( std::thread( &ThreadPool::_Loop, this, t ) );
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _quit = true;
+   }
+   _start.notify_all();
+   for( unsigned int t=0; t<_threads.size(); ++t )
+      _threads[t].join();
+}
+
+// _Loop()
+// Body of the pool's thread 'thread': works on each job as it comes.
+void ThreadPool::_Loop( int thread )
+{
+   int round = 0;
+   for( ;; )
+   {
+      {
+         std::unique_lock<std::mutex> lock( _mutex );
+         while ( _round == round && !_quit ) _start.wait( lock );
+         if ( _quit ) return;
+         round = _round;
+      }
+      _Work( thread );
+      std::lock_guard<std::mutex> lock( _mutex );
+      if ( --_running == 0 ) _done.notify_one();
+   }
+}
+
+// _Work()
+// Takes tasks of the current job until there are none left.
+void ThreadPool::_Work( int thread )
+{
+   for( int task = _next++; task < _count; task = _next++ )
+      (*_job)( task, thread );
+}
+
+// Run()
+// Runs tasks 0 to 'count'-1 of 'job' and returns when all are done.
+void ThreadPool::Run( ThreadPool::Job& job, int count )
+{
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _job = &job;
+      _count = count;
+      _next = 0;
+      _running = int(_threads.size());
+      _round++;
+   }
+   _start.notify_all();
+   _Work( 0 );
+
+   std::unique_lock<std::mutex> lock( _mutex );
+   while ( _running > 0 ) _done.wait( lock );
+}
+
+int ThreadPool::Threads() const
+{
+   return int(_threads.size()) + 1;
+}
+
+
+// HardwareThreads()
+// Returns the number of threads the hardware runs at once, at least 1.
+int HardwareThreads()
+{
+   return std::max( 1, int(std::thread::hardware_concurrency()) );
+}
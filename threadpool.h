@@ -0,0 +1,51 @@
+#ifndef ALNITE_THREADPOOL_H_
+#define ALNITE_THREADPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// A fixed set of threads sharing out the tasks of a job. The thread calling Run() works
+// on the job too, as thread 0, so a pool of one thread runs everything in the caller.
+class ThreadPool
+{
+public:
+   // Work of Run(), called once for each task, 0 to count-1, in no particular order, on
+   // the thread 'thread', 0 to Threads()-1. Tasks of the same thread run one after another.
+   class Job
+   {
+   public:
+      virtual ~Job() {}
+      virtual void operator()( int task, int thread ) = 0;
+   };
+
+private:
+   std::vector<std::thread>   _threads;      // threads 1 to Threads()-1
+   std::mutex                 _mutex;
+   std::condition_variable    _start;
+   std::condition_variable    _done;
+   Job*                       _job;
+   int                        _count;
+   std::atomic<int>           _next;         // next task to take
+   int                        _running;      // threads still on the job
+   int                        _round;        // jobs run so far
+   bool                       _quit;
+
+   void _Loop( int thread );
+   void _Work( int thread );
+
+   ThreadPool( const ThreadPool& );
+   ThreadPool& operator=( const ThreadPool& );
+
+public:
+   ThreadPool( int threads );
+   ~ThreadPool();
+
+   void Run( Job& job, int count );
+   int Threads() const;
+};
+
+int HardwareThreads();
+
+#endif
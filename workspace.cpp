@@ -0,0 +1,24 @@
+#include "lib.h"
+#include "workspace.h"
+
+const int BOARD_SIZE = 100;
+
+
+// Reserve()
+// Makes room for a search 'plies' deep, plus the leaves.
+void SearchWorkspace::Reserve( int plies )
+{
+   int old = int(_frames.size());
+   if ( old >= plies+1 ) return;
+   _frames.resize( plies+1 );
+   for( int i=old; i<plies+1; ++i )
+   {
+      _frames[i].board.resize( BOARD_SIZE, Reversi::EMPTY );
+      _frames[i].move_count = 0;
+   }
+}
+
+SearchWorkspace::Frame& SearchWorkspace::operator[]( int ply )
+{
+   return _frames[ply];
+}
@@ -0,0 +1,26 @@
+#ifndef ALNITE_WORKSPACE_H_
+#define ALNITE_WORKSPACE_H_
+
+#include "reversi.h"
+
+// Preallocated storage for a search, one frame per ply.
+// Once reserved for the search depth, searching does not allocate.
+class SearchWorkspace
+{
+public:
+   struct Frame
+   {
+      Reversi::board_type  board;                        // position at this ply
+      Reversi::index_type  moves[Reversi::MAX_MOVES];    // moves available at this ply
+      int                  move_count;
+   };
+
+private:
+   std::vector<Frame>   _frames;
+
+public:
+   void Reserve( int plies );
+   Frame& operator[]( int ply );
+};
+
+#endif